@@ -1,39 +1,22 @@
 #include "axis.h"
-#include "event.h"
-#include "time.h"
+#include "keycode.h"
 
-#define sqr(a) ((a)*(a))
-#define cub(a) ((a)*(a)*(a))
-#define clamp(a, a_low, a_high) ((a) < (a_low) ? (a_low) : (a) > (a_high) ? (a_high) : (a))
-
-Axis::Axis(int i, QObject *parent) : QObject(parent) {
-    index = i;
-    isOn = false;
-    isDown = false;
-    useMouse = false;
-    state = 0;
-    interpretation = ZeroOne;
-    gradient = false;
-    absolute = false;
-    toDefault();
-    tick = 0;
-}
-
-Axis::~Axis() {
-    release();
+Axis::Axis(int i, QVector<AxisData> *table, QObject *parent)
+    : QObject(parent), index(i), table(table) {
 }
 
 bool Axis::read(QTextStream &stream) {
-    QString input = stream.readLine().toLower();
+    QString input = stream.readLine();
     QRegExp regex("[\\s,]+");
     QStringList words = input.split(regex);
 
+    AxisData &d = data();
     bool ok;
     int val;
     float fval;
 
     for (QStringList::Iterator it = words.begin(); it != words.end(); ++it) {
-        QString word = *it;
+        QString word = (*it).toLower();
 
         // Remove colons at the end of tokens (e.g. "axis", "3:")
         if (word.endsWith(":")) {
@@ -44,28 +27,65 @@ bool Axis::read(QTextStream &stream) {
             ++it;
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
-            if (ok && val >= 0 && val <= MAXMOUSESPEED) maxSpeed = val;
+            if (ok && val >= 0 && val <= MAXMOUSESPEED) d.maxSpeed = val;
             else return false;
         }
         else if (word == "dzone") {
             ++it;
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
-            if (ok && val >= 0 && val <= JOYMAX) dZone = val;
+            if (ok && val >= 0 && val <= JOYMAX) d.dZone = val;
             else return false;
         }
+        else if (word == "dzonerelease" || word == "xzonerelease") {
+            ++it;
+            if (it == words.end()) return false;
+            val = (*it).toInt(&ok);
+            if (!ok || val < 0 || val > JOYMAX) return false;
+            if (word == "dzonerelease") d.dZoneRelease = val;
+            else d.xZoneRelease = val;
+        }
         else if (word == "xzone") {
             ++it;
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
-            if (ok && val >= 0 && val <= JOYMAX) xZone = val;
+            if (ok && val >= 0 && val <= JOYMAX) d.xZone = val;
+            else return false;
+        }
+        else if (word == "pwmperiod") {
+            ++it;
+            if (it == words.end()) return false;
+            val = (*it).toInt(&ok);
+            if (ok && val > 0) d.pwmPeriod = val;
+            else return false;
+        }
+        else if (word == "filtercutoff" || word == "filterbeta") {
+            ++it;
+            if (it == words.end()) return false;
+            fval = (*it).toFloat(&ok);
+            if (!ok || fval < 0.0F || fval > FILTER_MAXCUTOFF) return false;
+            if (word == "filtercutoff") d.filterCutoff = fval;
+            else d.filterBeta = fval;
+        }
+        else if (word == "monitor") {
+            ++it;
+            if (it == words.end()) return false;
+            val = (*it).toInt(&ok);
+            if (ok && val >= 0 && val <= MAXMONITORS) d.monitor = val;
+            else return false;
+        }
+        else if (word == "pwmlevels") {
+            ++it;
+            if (it == words.end()) return false;
+            val = (*it).toInt(&ok);
+            if (ok && val > 0 && val <= PWM_MAXLEVELS) d.pwmLevels = val;
             else return false;
         }
         else if (word == "tcurve") {
             ++it;
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
-            if (ok && val >= 0 && val <= PowerFunction) transferCurve = val;
+            if (ok && val >= 0 && val <= PowerFunction) d.transferCurve = (TransferCurve)val;
             else return false;
         }
         else if (word == "sens") {
@@ -73,21 +93,31 @@ bool Axis::read(QTextStream &stream) {
             if (it == words.end()) return false;
             fval = (*it).toFloat(&ok);
             if (ok && fval >= SENSITIVITY_MIN && fval <= SENSITIVITY_MAX)
-                sensitivity = fval;
+                d.sensitivity = fval;
             else return false;
         }
         else if (word == "+key") {
+            ++it;
+            if (it == words.end()) return false;
+            if (!readKey(*it, &d.pkeycode, &d.pkeysym)) return false;
+        }
+        else if (word == "-key") {
+            ++it;
+            if (it == words.end()) return false;
+            if (!readKey(*it, &d.nkeycode, &d.nkeysym)) return false;
+        }
+        else if (word == "+macro") {
             ++it;
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
-            if (ok && val >= 0 && val <= MAXKEY) pkeycode = val;
+            if (ok && val > 0) d.pmacro = val;
             else return false;
         }
-        else if (word == "-key") {
+        else if (word == "-macro") {
             ++it;
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
-            if (ok && val >= 0 && val <= MAXKEY) nkeycode = val;
+            if (ok && val > 0) d.nmacro = val;
             else return false;
         }
         else if (word == "+mouse") {
@@ -95,8 +125,9 @@ bool Axis::read(QTextStream &stream) {
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
             if (ok && val >= 0 && val <= MAXKEY) {
-                puseMouse = true;
-                pkeycode = val;
+                d.puseMouse = true;
+                d.pkeycode = val;
+                d.pkeysym = 0;
             }
             else return false;
         }
@@ -105,55 +136,56 @@ bool Axis::read(QTextStream &stream) {
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
             if (ok && val >= 0 && val <= MAXKEY) {
-                nuseMouse = true;
-                nkeycode = val;
+                d.nuseMouse = true;
+                d.nkeycode = val;
+                d.nkeysym = 0;
             }
             else return false;
         }
         else if (word == "zeroone") {
-            interpretation = ZeroOne;
-            gradient = false;
-            absolute = false;
+            d.interpretation = ZeroOne;
+            d.gradient = false;
+            d.absolute = false;
         }
         else if (word == "absolute") {
-            interpretation = AbsolutePos;
-            gradient = true;
-            absolute = true;
+            d.interpretation = AbsolutePos;
+            d.gradient = true;
+            d.absolute = true;
         }
         else if (word == "gradient") {
-            interpretation = Gradient;
-            gradient = true;
-            absolute = false;
+            d.interpretation = Gradient;
+            d.gradient = true;
+            d.absolute = false;
         }
         else if (word == "throttle+") {
-            throttle = 1;
+            d.throttle = 1;
         }
         else if (word == "throttle-") {
-            throttle = -1;
+            d.throttle = -1;
         }
         else if (word == "mouse+v") {
-            mode = MousePosVert;
+            d.mode = MousePosVert;
         }
         else if (word == "mouse-v") {
-            mode = MouseNegVert;
+            d.mode = MouseNegVert;
         }
         else if (word == "mouse+h") {
-            mode = MousePosHor;
+            d.mode = MousePosHor;
         }
         else if (word == "mouse-h") {
-            mode = MouseNegHor;
+            d.mode = MouseNegHor;
         }
         else if (word == "keyboardandmousehor") {
-            mode = KeyboardAndMouseHor;
+            d.mode = KeyboardAndMouseHor;
         }
         else if (word == "keyboardandmousevert") {
-            mode = KeyboardAndMouseVert;
+            d.mode = KeyboardAndMouseVert;
         }
         else if (word == "keyboardandmousehorrev") {
-            mode = KeyboardAndMouseHorRev;
+            d.mode = KeyboardAndMouseHorRev;
         }
         else if (word == "keyboardandmousevertrev") {
-            mode = KeyboardAndMouseVertRev;
+            d.mode = KeyboardAndMouseVertRev;
         }
         else {
             // Unknown word - instead of returning false, just ignore and continue
@@ -162,21 +194,18 @@ bool Axis::read(QTextStream &stream) {
         }
     }
 
-    adjustGradient();
+    d.configure();
 
     return true;
 }
 
 
-void Axis::timerCalled() {
-    timerTick(++tick);
-}
-
 void Axis::write(QTextStream &stream) {
+    const AxisData &d = data();
     // write regular axis parameters:
     stream << "Axis " << (index + 1) << ": ";
 
-    switch (interpretation) {
+    switch (d.interpretation) {
     case ZeroOne:
         stream << "ZeroOne, ";
         break;
@@ -188,27 +217,39 @@ void Axis::write(QTextStream &stream) {
         break;
     }
 
-    stream << "dZone " << dZone << ", "
-           << "xZone " << xZone << ", "
-           << "maxSpeed " << maxSpeed << ", "
-           << "tCurve " << transferCurve;
+    stream << "dZone " << d.dZone << ", "
+           << "xZone " << d.xZone << ", "
+           << "maxSpeed " << d.maxSpeed << ", "
+           << "tCurve " << d.transferCurve;
+    if (d.pwmPeriod != PWM_PERIOD_MSEC) stream << ", pwmPeriod " << d.pwmPeriod;
+    if (d.pwmLevels != PWM_LEVELS) stream << ", pwmLevels " << d.pwmLevels;
+    if (d.dZoneRelease >= 0) stream << ", dZoneRelease " << d.dZoneRelease;
+    if (d.xZoneRelease >= 0) stream << ", xZoneRelease " << d.xZoneRelease;
+    if (d.monitor != 0) stream << ", monitor " << d.monitor;
+    if (d.filterCutoff != 0.0F) stream << ", filterCutoff " << d.filterCutoff;
+    if (d.filterBeta != 0.0F) stream << ", filterBeta " << d.filterBeta;
 
     // write keys and mode if applicable
 
     // Write keys +key / -key or +mouse / -mouse for keyboard and keyboard+mouse modes
-    if (mode == Keyboard ||
-        mode == KeyboardAndMouseHor ||
-        mode == KeyboardAndMouseVert ||
-        mode == KeyboardAndMouseHorRev ||
-        mode == KeyboardAndMouseVertRev) {
+    if (d.mode == Keyboard ||
+        d.mode == KeyboardAndMouseHor ||
+        d.mode == KeyboardAndMouseVert ||
+        d.mode == KeyboardAndMouseHorRev ||
+        d.mode == KeyboardAndMouseVertRev) {
         
-        stream << ", " 
-               << (puseMouse ? "+mouse " : "+key ") << pkeycode << ", "
-               << (nuseMouse ? "-mouse " : "-key ") << nkeycode;
+        stream << ", ";
+        if (d.puseMouse) stream << "+mouse " << d.pkeycode;
+        else stream << "+key " << keyString(d.pkeycode, d.pkeysym);
+        stream << ", ";
+        if (d.nuseMouse) stream << "-mouse " << d.nkeycode;
+        else stream << "-key " << keyString(d.nkeycode, d.nkeysym);
+        if (d.pmacro > 0) stream << ", +macro " << d.pmacro;
+        if (d.nmacro > 0) stream << ", -macro " << d.nmacro;
     }
 
     // Write mode as name (for easier reading)
-    switch (mode) {
+    switch (d.mode) {
         case Keyboard:
             stream << ", keyboard";
             break;
@@ -243,80 +284,19 @@ void Axis::write(QTextStream &stream) {
 
 
 void Axis::release() {
-    if (isDown) {
-        move(false);
-        isDown = false;
-    }
+    data().release();
 }
 
 void Axis::jsevent(int value) {
-    if (throttle == 0)
-        state = value;
-    else if (throttle == -1)
-        state = (value + JOYMIN) / 2;
-    else
-        state = (value + JOYMAX) / 2;
-
-    if (isOn && abs(state) <= dZone) {
-        isOn = false;
-        if (gradient) {
-            duration = 0;
-            release();
-            timer.stop();
-            disconnect(&timer, SIGNAL(timeout()), 0, 0);
-            tick = 0;
-        }
-    }
-    else if (!isOn && abs(state) >= dZone) {
-        isOn = true;
-        if (gradient) {
-            duration = (abs(state) * FREQ) / JOYMAX;
-            connect(&timer, SIGNAL(timeout()), this, SLOT(timerCalled()));
-            timer.start(MSEC);
-        }
-    }
-    else return;
-
-    if (!gradient) {
-        move(isOn);
-    }
+    data().jsevent(value, uint32_t(Scheduler::instance().now()));
 }
 
 void Axis::toDefault() {
-    release();
-    interpretation = ZeroOne;
-    gradient = false;
-    absolute = false;
-    throttle = 0;
-    maxSpeed = 100;
-    transferCurve = Quadratic;
-    sensitivity = 1.0F;
-    dZone = DZONE;
-    tick = 0;
-    xZone = XZONE;
-    mode = Keyboard;
-    pkeycode = 0;
-    nkeycode = 0;
-    puseMouse = false;
-    nuseMouse = false;
-    downkey = 0;
-    state = 0;
-    adjustGradient();
+    data().toDefault();
 }
 
 bool Axis::isDefault() {
-    return (interpretation == ZeroOne) &&
-           (gradient == false) &&
-           (absolute == false) &&
-           (throttle == 0) &&
-           (maxSpeed == 100) &&
-           (dZone == DZONE) &&
-           (xZone == XZONE) &&
-           (mode == Keyboard) &&
-           (pkeycode == 0) &&
-           (nkeycode == 0) &&
-           (puseMouse == false) &&
-           (nuseMouse == false);
+    return data().isDefault();
 }
 
 QString Axis::getName() {
@@ -324,24 +304,18 @@ QString Axis::getName() {
 }
 
 bool Axis::inDeadZone(int val) {
-    int value;
-    if (throttle == 0)
-        value = val;
-    else if (throttle == -1)
-        value = (val + JOYMIN) / 2;
-    else
-        value = (val + JOYMAX) / 2;
-    return (abs(value) < dZone);
+    return data().inDeadZone(val);
 }
 
 QString Axis::status() {
+    const AxisData &d = data();
     QString label;
-    if (mode == Keyboard) {
-        if (throttle == 0) {
-            if (puseMouse != nuseMouse) {
+    if (d.mode == Keyboard) {
+        if (d.throttle == 0) {
+            if (d.puseMouse != d.nuseMouse) {
                 label = tr("KEYBOARD/MOUSE");
             }
-            else if (puseMouse) {
+            else if (d.puseMouse) {
                 label = tr("MOUSE");
             }
             else {
@@ -363,240 +337,15 @@ void Axis::setKey(bool positive, int value) {
 }
 
 void Axis::setKey(bool useMouse, bool positive, int value) {
+    AxisData &d = data();
     if (positive) {
-        pkeycode = value;
-        puseMouse = useMouse;
+        if (useMouse || value != d.pkeycode) d.pkeysym = 0;
+        d.pkeycode = value;
+        d.puseMouse = useMouse;
     }
     else {
-        nkeycode = value;
-        nuseMouse = useMouse;
-    }
-}
-
-void Axis::timerTick(int tick) {
-    if (isOn) {
-        if (mode == Keyboard) {
-            if (tick % FREQ == 0) {
-                if (duration == FREQ) {
-                    if (!isDown) move(true);
-                    duration = (abs(state) * FREQ) / JOYMAX;
-                    return;
-                }
-                move(true);
-            }
-            if (tick % FREQ == duration) {
-                move(false);
-                duration = (abs(state) * FREQ) / JOYMAX;
-            }
-        }
-        else {
-            move(true);
-        }
-    }
-}
-
-void Axis::adjustGradient() {
-    inverseRange = 1.0F / (xZone - dZone);
-    sumDist = 0;
-}
-
-void Axis::move(bool press) {
-    FakeEvent e;
-
-    // Support keyboard and mouse simultaneously in KeyboardAndMouse* modes
-//    bool mouseMoveActive = false;
-    bool keyboardPress = false;
-
-    if (
-        mode == Keyboard ||
-        mode == KeyboardAndMouseHor ||
-        mode == KeyboardAndMouseVert ||
-        mode == KeyboardAndMouseHorRev ||
-        mode == KeyboardAndMouseVertRev
-    ) {
-        // handle key presses:
-        if (isDown == press && mode == Keyboard) return; // prevent repeats
-        if (mode == Keyboard) {
-            if (state != 0) {
-                useMouse = (state > 0) ? puseMouse : nuseMouse;
-            }
-            if (press) {
-                e.type = useMouse ? FakeEvent::MouseDown : FakeEvent::KeyDown;
-                downkey = (state > 0) ? pkeycode : nkeycode;
-            }
-            else {
-                e.type = useMouse ? FakeEvent::MouseUp : FakeEvent::KeyUp;
-            }
-            e.keycode = downkey;
-            sendevent(e);
-            isDown = press;
-            return;
-        }
-        else {
-            // KeyboardAndMouse* modes - mouse movement + keys
-            keyboardPress = press && (abs(state) >= xZone);
-
-            // handle keys:
-            if (keyboardPress) {
-                // if key not pressed, press it
-                if (!isDown) {
-                    e.type = ( (state > 0) ? (puseMouse ? FakeEvent::MouseDown : FakeEvent::KeyDown) :
-                              (nuseMouse ? FakeEvent::MouseDown : FakeEvent::KeyDown));
-                    downkey = (state > 0) ? pkeycode : nkeycode;
-                    e.keycode = downkey;
-                    sendevent(e);
-                    isDown = true;
-                }
-            }
-            else {
-                // if key should be released
-                if (isDown) {
-                    e.type = ( (state > 0) ? (puseMouse ? FakeEvent::MouseUp : FakeEvent::KeyUp) :
-                              (nuseMouse ? FakeEvent::MouseUp : FakeEvent::KeyUp));
-                    e.keycode = downkey;
-                    sendevent(e);
-                    isDown = false;
-                }
-            }
-
-            // handle mouse:
-
-            int dist = 0;
-            if (gradient) {
-                const int absState = abs(state);
-                float fdist;
-
-                if (absState >= xZone) fdist = 1.0F;
-                else if (absState <= dZone) fdist = 0.0F;
-                else {
-                    const float u = inverseRange * (absState - dZone);
-                    switch (transferCurve) {
-                    case Quadratic: fdist = sqr(u); break;
-                    case Cubic: fdist = cub(u); break;
-                    case QuadraticExtreme:
-                        fdist = sqr(u);
-                        if (u >= 0.95F) fdist *= 1.5F;
-                        break;
-                    case PowerFunction:
-                        fdist = clamp(powf(u, 1.0F / clamp(sensitivity, 1e-8F, 1e+3F)), 0.0F, 1.0F);
-                        break;
-                    default:
-                        fdist = u;
-                    }
-                }
-                fdist *= maxSpeed;
-                if (state < 0) fdist = -fdist;
-                sumDist += fdist;
-                dist = int(sumDist);
-                sumDist -= dist;
-            }
-            else {
-                dist = (state >= 0) ? maxSpeed : -maxSpeed;
-            }
-
-            e.type = FakeEvent::MouseMove;
-            e.move.x = 0;
-            e.move.y = 0;
-
-            // Set mouse movement depending on mode:
-            switch (mode) {
-                case MousePosVert:
-                    e.move.y = dist;
-                    break;
-                case MouseNegVert:
-                    e.move.y = -dist;
-                    break;
-                case MousePosHor:
-                    e.move.x = dist;
-                    break;
-                case MouseNegHor:
-                    e.move.x = -dist;
-                    break;
-                    case KeyboardAndMouseHor:
-                        e.move.x = dist;
-                        break;
-                    case KeyboardAndMouseHorRev:
-                        e.move.x = -dist;
-                        break;
-                    case KeyboardAndMouseVert:
-                        e.move.y = dist;
-                        break;
-                    case KeyboardAndMouseVertRev:
-                        e.move.y = -dist;
-                        break;
-
-                default:
-                    break;
-            }
-
-            if (e.move.x != 0 || e.move.y != 0) {
-                sendevent(e);
-//                mouseMoveActive = true;
-            }
-
-            // Keyboard was handled above (keyboardPress/isDown)
-
-            return;
-        }
-    }
-    else if (mode == MousePosVert || mode == MouseNegVert || mode == MousePosHor || mode == MouseNegHor) {
-        // Old modes, mouse only
-        int dist = 0;
-        if (gradient) {
-            const int absState = abs(state);
-            float fdist;
-
-            if (absState >= xZone) fdist = 1.0F;
-            else if (absState <= dZone) fdist = 0.0F;
-            else {
-                const float u = inverseRange * (absState - dZone);
-                switch (transferCurve) {
-                case Quadratic: fdist = sqr(u); break;
-                case Cubic: fdist = cub(u); break;
-                case QuadraticExtreme:
-                    fdist = sqr(u);
-                    if (u >= 0.95F) fdist *= 1.5F;
-                    break;
-                case PowerFunction:
-                    fdist = clamp(powf(u, 1.0F / clamp(sensitivity, 1e-8F, 1e+3F)), 0.0F, 1.0F);
-                    break;
-                default:
-                    fdist = u;
-                }
-            }
-            fdist *= maxSpeed;
-            if (state < 0) fdist = -fdist;
-            sumDist += fdist;
-            dist = int(sumDist);
-            sumDist -= dist;
-        }
-        else {
-            dist = (state >= 0) ? maxSpeed : -maxSpeed;
-        }
-
-        FakeEvent e;
-        e.type = FakeEvent::MouseMove;
-        e.move.x = 0;
-        e.move.y = 0;
-
-        switch (mode) {
-            case MousePosVert: e.move.y = dist; break;
-            case MouseNegVert: e.move.y = -dist; break;
-            case MousePosHor: e.move.x = dist; break;
-            case MouseNegHor: e.move.x = -dist; break;
-            default: break;
-        }
-
-        if (e.move.x != 0 || e.move.y != 0)
-            sendevent(e);
-    }
-    else if (mode == Keyboard) {
-        // Old keyboard-only modes
-        if (isDown == press) return;
-        isDown = press;
-        FakeEvent e;
-        e.type = (useMouse ? (press ? FakeEvent::MouseDown : FakeEvent::MouseUp) : (press ? FakeEvent::KeyDown : FakeEvent::KeyUp));
-        e.keycode = (state > 0) ? pkeycode : nkeycode;
-        sendevent(e);
+        if (useMouse || value != d.nkeycode) d.nkeysym = 0;
+        d.nkeycode = value;
+        d.nuseMouse = useMouse;
     }
 }
@@ -2,43 +2,24 @@
 #define QJOYPAD_AXIS_H
 
 #include <stdlib.h>
-#include <math.h>
 
-#include <QTimer>
+#include <QObject>
 #include <QTextStream>
 #include <QRegExp>
 #include <QStringList>
-#include "constant.h"
+#include <QVector>
+#include "axisdata.h"
 #include "error.h"
 
-#define DZONE 3000
-#define XZONE 30000
-
-class Axis : public QObject {
+//a view on one entry of a JoyPad's axis table. The table is what processes
+//events, this is what reads, writes and edits its settings.
+class Axis : public QObject, public AxisEnums {
     Q_OBJECT
 
 public:
-    enum Interpretation { ZeroOne, Gradient, AbsolutePos };
-
-    // Added new modes for extended axis handling:
-    enum Mode {
-        Keyboard,
-        MousePosVert,
-        MouseNegVert,
-        MousePosHor,
-        MouseNegHor,
-        KeyboardAndMouseHor,     // new mode: horizontal mouse movement + keys
-        KeyboardAndMouseVert,    // new mode: vertical mouse movement + keys
-        KeyboardAndMouseHorRev,
-        KeyboardAndMouseVertRev,
-    };
-
-    enum TransferCurve { Linear, Quadratic, Cubic, QuadraticExtreme, PowerFunction };
-
     friend class AxisEdit;
 
-    Axis(int i, QObject *parent = 0);
-    ~Axis();
+    Axis(int i, QVector<AxisData> *table, QObject *parent = 0);
 
     bool read(QTextStream &stream);
     void write(QTextStream &stream);
@@ -53,42 +34,12 @@ public:
     void setKey(bool positive, int value);
     void setKey(bool useMouse, bool positive, int value);
 
-    void timerTick(int tick);
-    void adjustGradient();
     int axisIndex() const { return index; }
+    AxisData &data() { return (*table)[index]; }
 
 protected:
-    int tick;
-    bool isOn;
     int index;
-    virtual void move(bool press);
-    bool isDown;
-    bool useMouse;
-
-    float inverseRange;
-
-    Interpretation interpretation;
-    bool gradient;
-    bool absolute;
-    int maxSpeed;
-    unsigned int transferCurve;
-    float sensitivity;
-    int throttle;
-    int dZone;
-    int xZone;
-    double sumDist;
-    Mode mode;
-    int pkeycode;
-    int nkeycode;
-    bool puseMouse;
-    bool nuseMouse;
-    int downkey;
-    int state;
-    int duration;
-    QTimer timer;
-
-protected slots:
-    void timerCalled();
+    QVector<AxisData> *table;
 };
 
 #endif
@@ -4,6 +4,7 @@
 AxisEdit::AxisEdit( Axis* ax )
         :QDialog() {
     axis = ax;
+    const AxisData &d = axis->data();
     setWindowTitle("Set " + axis->getName());
     setWindowIcon(QPixmap(QJOYPAD_ICON24));
 
@@ -20,7 +21,7 @@ AxisEdit::AxisEdit( Axis* ax )
     chkGradient->insertItem((int) Axis::ZeroOne, tr("Use 0 or max always"), Qt::DisplayRole);
     chkGradient->insertItem((int) Axis::Gradient, tr("Relative movement (previously gradient)"), Qt::DisplayRole);
     chkGradient->insertItem((int) Axis::AbsolutePos, tr("Absolute movement (direct position)"), Qt::DisplayRole);
-    chkGradient->setCurrentIndex( axis->interpretation );
+    chkGradient->setCurrentIndex( d.interpretation );
     connect(chkGradient, SIGNAL(activated(int)), this, SLOT( gradientChanged( int )));
     v2->addWidget(chkGradient);
 
@@ -35,7 +36,7 @@ AxisEdit::AxisEdit( Axis* ax )
     cmbMode->insertItem((int) Axis::KeyboardAndMouseVert, tr("Keyboard + Mouse (Vert.)"), Qt::DisplayRole);
     cmbMode->insertItem((int) Axis::KeyboardAndMouseVertRev, tr("Keyboard + Mouse (Vert. Rev.)"), Qt::DisplayRole);
 
-    cmbMode->setCurrentIndex( axis->mode );
+    cmbMode->setCurrentIndex( d.mode );
     connect(cmbMode, SIGNAL(activated(int)), this, SLOT( modeChanged( int )));
     v2->addWidget(cmbMode);
 
@@ -45,8 +46,8 @@ AxisEdit::AxisEdit( Axis* ax )
     cmbTransferCurve->insertItem(Axis::Cubic, tr("Cubic"), Qt::DisplayRole );
     cmbTransferCurve->insertItem(Axis::QuadraticExtreme, tr("Quadratic Extreme"), Qt::DisplayRole);
     cmbTransferCurve->insertItem(Axis::PowerFunction, tr("Power Function"), Qt::DisplayRole);
-    cmbTransferCurve->setCurrentIndex( axis->transferCurve );
-    cmbTransferCurve->setEnabled(axis->gradient);
+    cmbTransferCurve->setCurrentIndex( d.transferCurve );
+    cmbTransferCurve->setEnabled(d.gradient);
     connect(cmbTransferCurve, SIGNAL(activated(int)), this, SLOT( transferCurveChanged( int )));
     v2->addWidget(cmbTransferCurve);
 
@@ -62,14 +63,14 @@ AxisEdit::AxisEdit( Axis* ax )
     spinSpeed = new QSpinBox(mouseBox);
     spinSpeed->setRange(0,MAXMOUSESPEED);
     spinSpeed->setSingleStep(1);
-    spinSpeed->setValue(axis->maxSpeed);
+    spinSpeed->setValue(d.maxSpeed);
     v2->addWidget(spinSpeed);
     lblSensitivity = new QLabel(tr("&Sensitivity"), mouseBox);
     v2->addWidget(lblSensitivity);
     spinSensitivity = new QDoubleSpinBox(mouseBox);
     spinSensitivity->setRange(1e-3F, 1e+3F);
     spinSensitivity->setSingleStep(0.10);
-    spinSensitivity->setValue(axis->sensitivity);
+    spinSensitivity->setValue(d.sensitivity);
     v2->addWidget(spinSensitivity);
     h->addWidget(mouseBox);
     mouseLabel->setBuddy(spinSpeed);
@@ -77,7 +78,7 @@ AxisEdit::AxisEdit( Axis* ax )
 
     v->addLayout(h);
 
-    slider = new JoySlider(axis->dZone, axis->xZone, axis->state, this);
+    slider = new JoySlider(d.dZone, d.xZone, d.state, this);
     v->addWidget(slider);
 
     keyBox = new QFrame(this);
@@ -86,16 +87,16 @@ AxisEdit::AxisEdit( Axis* ax )
     h->setSpacing(5);
     h->setMargin(5);
 
-    btnNeg = new KeyButton(axis->getName(),axis->nkeycode,keyBox,true,axis->nuseMouse);
+    btnNeg = new KeyButton(axis->getName(),d.nkeycode,keyBox,true,d.nuseMouse);
 
     cmbThrottle = new QComboBox(keyBox);
     cmbThrottle->insertItem(0, tr("Neg. Throttle"), Qt::DisplayRole);
     cmbThrottle->insertItem(1, tr("No Throttle"), Qt::DisplayRole);
     cmbThrottle->insertItem(2, tr("Pos. Throttle"), Qt::DisplayRole);
-    cmbThrottle->setCurrentIndex(axis->throttle + 1);
+    cmbThrottle->setCurrentIndex(d.throttle + 1);
     connect( cmbThrottle, SIGNAL( activated( int )), this, SLOT( throttleChanged( int )));
 
-    btnPos = new KeyButton(axis->getName(),axis->pkeycode,keyBox,true,axis->puseMouse);
+    btnPos = new KeyButton(axis->getName(),d.pkeycode,keyBox,true,d.puseMouse);
 
     h->addWidget(btnNeg);
     h->addWidget(cmbThrottle);
@@ -109,10 +110,10 @@ AxisEdit::AxisEdit( Axis* ax )
     v->addWidget(buttonBox);
 
     // Initialize dialog controls to current axis state
-    gradientChanged( axis->interpretation );
-    modeChanged( axis->mode );
-    transferCurveChanged( axis->transferCurve );
-    throttleChanged( axis->throttle + 1 );
+    gradientChanged( d.interpretation );
+    modeChanged( d.mode );
+    transferCurveChanged( d.transferCurve );
+    throttleChanged( d.throttle + 1 );
 }
 
 void AxisEdit::show() {
@@ -128,7 +129,7 @@ void AxisEdit::gradientChanged( int index ) {
     bool gradient = index != Axis::ZeroOne;
     cmbTransferCurve->setEnabled(gradient);
     if (gradient) {
-        transferCurveChanged( axis->transferCurve );
+        transferCurveChanged( axis->data().transferCurve );
     }
     else {
         lblSensitivity->setEnabled(false);
@@ -150,7 +151,7 @@ void AxisEdit::modeChanged( int index ) {
             keyBox->setEnabled(true);
             if ((Axis::Interpretation)chkGradient->currentIndex() != Axis::ZeroOne) {
                 cmbTransferCurve->setEnabled(true);
-                transferCurveChanged(axis->transferCurve);
+                transferCurveChanged(axis->data().transferCurve);
             }
             break;
         default:
@@ -158,7 +159,7 @@ void AxisEdit::modeChanged( int index ) {
             keyBox->setEnabled(false);
             if ((Axis::Interpretation)chkGradient->currentIndex() != Axis::ZeroOne) {
                 cmbTransferCurve->setEnabled(true);
-                transferCurveChanged(axis->transferCurve);
+                transferCurveChanged(axis->data().transferCurve);
             }
             break;
     }
@@ -194,21 +195,20 @@ void AxisEdit::throttleChanged( int index ) {
 }
 
 void AxisEdit::accept() {
-    axis->interpretation = (Axis::Interpretation)chkGradient->currentIndex(); 
-    axis->gradient = axis->interpretation != Axis::ZeroOne;
-    axis->absolute = axis->interpretation == Axis::AbsolutePos;
-    axis->maxSpeed = spinSpeed->value();
-    axis->transferCurve = (Axis::TransferCurve)cmbTransferCurve->currentIndex();
-    axis->sensitivity = spinSensitivity->value();
-    axis->throttle = cmbThrottle->currentIndex() - 1;
-    axis->dZone = slider->deadZone();
-    axis->xZone = slider->xZone();
-    axis->mode = (Axis::Mode) cmbMode->currentIndex();
-    axis->pkeycode = btnPos->getValue();
-    axis->nkeycode = btnNeg->getValue();
-    axis->puseMouse = btnPos->choseMouse();
-    axis->nuseMouse = btnNeg->choseMouse();
-    axis->adjustGradient();
+    AxisData &d = axis->data();
+    d.interpretation = (Axis::Interpretation)chkGradient->currentIndex(); 
+    d.gradient = d.interpretation != Axis::ZeroOne;
+    d.absolute = d.interpretation == Axis::AbsolutePos;
+    d.maxSpeed = spinSpeed->value();
+    d.transferCurve = (Axis::TransferCurve)cmbTransferCurve->currentIndex();
+    d.sensitivity = spinSensitivity->value();
+    d.throttle = cmbThrottle->currentIndex() - 1;
+    d.dZone = slider->deadZone();
+    d.xZone = slider->xZone();
+    d.mode = (Axis::Mode) cmbMode->currentIndex();
+    axis->setKey(btnPos->choseMouse(), true, btnPos->getValue());
+    axis->setKey(btnNeg->choseMouse(), false, btnNeg->getValue());
+    d.configure();
 
     QDialog::accept();
 }
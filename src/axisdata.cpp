@@ -0,0 +1,477 @@
+#include <stdlib.h>
+
+#include "axisdata.h"
+#include "event.h"
+#include "motion.h"
+#include "macro.h"
+#include "screen.h"
+
+#define clamp(a, a_low, a_high) ((a) < (a_low) ? (a_low) : (a) > (a_high) ? (a_high) : (a))
+
+AxisData::AxisData() {
+    isOn = false;
+    isDown = false;
+    useMouse = false;
+    state = 0;
+    pwmStart = 0;
+    pwmCycle = 0;
+    pwmReleaseDue = false;
+    pwmDue = -1;
+    settleDue = -1;
+    lane = -1;
+    pplayer = 0;
+    nplayer = 0;
+    downplayer = 0;
+    pointers = 0;
+    motionX = 0;
+    motionY = 0;
+    interpretation = ZeroOne;
+    gradient = false;
+    absolute = false;
+    toDefault();
+}
+
+int AxisData::throttled(int throttle, int value) {
+    if (throttle == 0)
+        return value;
+    else if (throttle < 0)
+        return (value + JOYMIN) / 2;
+    else
+        return (value + JOYMAX) / 2;
+}
+
+void AxisData::release() {
+    //a filter that is catching up keeps doing so, the axis may still move
+    pwmDue = -1;
+    pwmReleaseDue = false;
+    reschedule();
+    //stop moving the mouse until the axis is pushed again
+    if (lane >= 0) {
+        rest = MotionBatch::instance().releaseLane(lane);
+        lane = -1;
+        isOn = false;
+    }
+    if (isDown) {
+        move(false);
+        isDown = false;
+    }
+    if (pplayer) pplayer->stop();
+    if (nplayer) nplayer->stop();
+}
+
+//take, update or give back the lane in the motion batch
+void AxisData::updateLane() {
+    const bool needsLane = isOn && (motionX != 0 || motionY != 0);
+    if (needsLane && lane < 0) {
+        lane = MotionBatch::instance().acquire(motionX, motionY, rest);
+    }
+    else if (!needsLane && lane >= 0) {
+        rest = MotionBatch::instance().releaseLane(lane);
+        lane = -1;
+    }
+    if (lane >= 0) {
+        MotionBatch::instance().set(lane, *this);
+    }
+}
+
+void AxisData::jsevent(int value, uint32_t time) {
+    value = throttled(value);
+    if (filter.isOn()) {
+        value = filter.step(value, time);
+        //no more events come once the axis rests, so the filter is stepped
+        //until it gets there
+        if (settleDue < 0 && !filter.isSettled()) {
+            settleDue = Scheduler::instance().now() + FILTER_SETTLE_MSEC;
+            reschedule();
+        }
+    }
+    update(value);
+}
+
+void AxisData::update(int value) {
+    state = value;
+    if (absolute && mode != Keyboard) {
+        //there is no on and off, the pointer goes wherever the axis is
+        updateFn(*this);
+        return;
+    }
+    if (lane >= 0) {
+        MotionBatch::instance().set(lane, *this);
+    }
+
+    if (isOn && abs(state) <= dRelease) {
+        isOn = false;
+        if (gradient) {
+            release();
+            updateLane();
+        }
+    }
+    else if (!isOn && abs(state) >= dZone) {
+        isOn = true;
+        if (gradient && mode == Keyboard) {
+            //pwm, timed by the scheduler. The first pulse starts right away.
+            pwmStart = Scheduler::instance().now();
+            pwmCycle = 0;
+            pwmPulse();
+        }
+        else if (gradient) {
+            updateLane();
+        }
+    }
+    else {
+        if (isOn && gradient) updateFn(*this);
+        return;
+    }
+
+    if (!gradient) {
+        move(isOn);
+    }
+    else if (isOn) {
+        updateFn(*this);
+    }
+}
+
+void AxisData::toDefault() {
+    release();
+    interpretation = ZeroOne;
+    gradient = false;
+    absolute = false;
+    throttle = 0;
+    maxSpeed = 100;
+    transferCurve = Quadratic;
+    sensitivity = 1.0F;
+    dZone = DZONE;
+    xZone = XZONE;
+    dZoneRelease = -1;
+    xZoneRelease = -1;
+    pwmPeriod = PWM_PERIOD_MSEC;
+    pwmLevels = PWM_LEVELS;
+    monitor = 0;
+    filterCutoff = 0.0F;
+    filterBeta = 0.0F;
+    mode = Keyboard;
+    pkeycode = 0;
+    nkeycode = 0;
+    pkeysym = 0;
+    nkeysym = 0;
+    pmacro = 0;
+    nmacro = 0;
+    pplayer = 0;
+    nplayer = 0;
+    downplayer = 0;
+    puseMouse = false;
+    nuseMouse = false;
+    downkey = 0;
+    state = 0;
+    configure();
+}
+
+bool AxisData::isDefault() const {
+    return (interpretation == ZeroOne) &&
+           (gradient == false) &&
+           (absolute == false) &&
+           (throttle == 0) &&
+           (maxSpeed == 100) &&
+           (dZone == DZONE) &&
+           (pwmPeriod == PWM_PERIOD_MSEC) &&
+           (pwmLevels == PWM_LEVELS) &&
+           (monitor == 0) &&
+           (filterCutoff == 0.0F) &&
+           (filterBeta == 0.0F) &&
+           (xZone == XZONE) &&
+           (dZoneRelease == -1) &&
+           (xZoneRelease == -1) &&
+           (mode == Keyboard) &&
+           (pkeycode == 0) &&
+           (nkeycode == 0) &&
+           (pkeysym == 0) &&
+           (nkeysym == 0) &&
+           (pmacro == 0) &&
+           (nmacro == 0) &&
+           (puseMouse == false) &&
+           (nuseMouse == false);
+}
+
+bool AxisData::inDeadZone(int val) const {
+    return (abs(throttled(val)) < dZone);
+}
+
+void AxisData::pwmPulse() {
+    //how long the key is held this cycle is worked out from the value the
+    //axis has now, with pwmLevels steps between not at all and all the time.
+    const int64_t start = pwmStart + int64_t(pwmCycle) * pwmPeriod;
+    const int level = (clamp(abs(state), 0, JOYMAX) * pwmLevels) / JOYMAX;
+    move(true);
+    if (level >= pwmLevels) {
+        //held for the whole cycle
+        pwmDue = start + pwmPeriod;
+    }
+    else {
+        pwmReleaseDue = true;
+        pwmDue = start + (int64_t(pwmPeriod) * level) / pwmLevels;
+    }
+    reschedule();
+}
+
+void AxisData::pwmEdge(int64_t now) {
+    const bool release = pwmReleaseDue;
+    if (release) {
+        pwmReleaseDue = false;
+        move(false);
+    }
+    else {
+        ++ pwmCycle;
+    }
+    //if we fell behind (the event loop was blocked, or the machine slept),
+    //skip the cycles that were missed instead of sending all their edges at
+    //once
+    const int current = int((now - pwmStart) / pwmPeriod);
+    if (current > pwmCycle) pwmCycle = current;
+    if (release) {
+        pwmDue = pwmStart + int64_t(pwmCycle + 1) * pwmPeriod;
+        reschedule();
+    }
+    else {
+        pwmPulse();
+    }
+}
+
+void AxisData::reschedule() {
+    int64_t due = pwmDue;
+    if (settleDue >= 0 && (due < 0 || settleDue < due)) due = settleDue;
+    if (due >= 0) Scheduler::instance().schedule(this, due);
+    else Scheduler::instance().cancel(this);
+}
+
+void AxisData::fire(int64_t now) {
+    if (settleDue >= 0 && settleDue <= now) {
+        settleDue = -1;
+        const bool settled = filter.settle(FILTER_SETTLE_MSEC);
+        if (!settled) settleDue = now + FILTER_SETTLE_MSEC;
+        update(filter.output());
+    }
+    if (pwmDue >= 0 && pwmDue <= now) {
+        pwmDue = -1;
+        pwmEdge(now);
+    }
+    reschedule();
+}
+
+//the mouse speed for the current state, from 0 to FIX_ONE, for each transfer
+//curve. The same as a lane of the MotionBatch works out, and the switch is
+//resolved at compile time.
+template <int Curve>
+static inline int32_t curveValue(const AxisData &axis, int32_t u) {
+    const int32_t u2 = (u * u) >> FIX_SHIFT;
+    switch (Curve) {
+    case AxisData::Quadratic: return u2;
+    case AxisData::Cubic: return (u2 * u) >> FIX_SHIFT;
+    case AxisData::QuadraticExtreme: return (u >= FIX_KNEE) ? (u2 * FIX_EXTREME) >> FIX_SHIFT : u2;
+    case AxisData::PowerFunction: return fixPow(u, axis.exponent);
+    default: return u;
+    }
+}
+
+//how far the mouse moves this tick. Sub-pixel movement is accumulated in
+//rest so slow speeds still move the mouse eventually.
+template <bool Gradient, int Curve>
+static inline int mouseDistance(AxisData &axis) {
+    if (!Gradient) {
+        return (axis.state >= 0) ? axis.maxSpeed : -axis.maxSpeed;
+    }
+    const int absState = abs(axis.state);
+    int32_t f;
+
+    if (absState >= axis.xZone) f = FIX_ONE;
+    else if (absState <= axis.dZone) f = 0;
+    else f = curveValue<Curve>(axis, fixUnit(absState, axis.dZone, axis.xZone, axis.inverseRange));
+
+    const int32_t speed = axis.maxSpeed << SPEED_SHIFT;
+    axis.rest += f * ((axis.state < 0) ? -speed : speed);
+    const int32_t dist = restPixels(axis.rest);
+    axis.rest -= dist * (1 << REST_SHIFT);
+    return dist;
+}
+
+//press the key, mouse button or macro for the direction the axis is pushed
+//in, or release whichever was pressed.
+static inline void sendKey(AxisData &axis, bool press, bool useMouse) {
+    FakeEvent e;
+    if (press) {
+        MacroPlayer *player = (axis.state > 0) ? axis.pplayer : axis.nplayer;
+        if (player) {
+            axis.downplayer = player;
+            player->press();
+            return;
+        }
+        e.type = useMouse ? FakeEvent::MouseDown : FakeEvent::KeyDown;
+        axis.downkey = (axis.state > 0) ? axis.pkeycode : axis.nkeycode;
+    }
+    else {
+        if (axis.downplayer) {
+            axis.downplayer->release();
+            axis.downplayer = 0;
+            return;
+        }
+        e.type = useMouse ? FakeEvent::MouseUp : FakeEvent::KeyUp;
+    }
+    e.keycode = axis.downkey;
+    sendevent(e);
+}
+
+//Keyboard mode: a key or mouse button for each direction.
+struct KeyboardKernel {
+    static void move(AxisData &axis, bool press) {
+        if (axis.isDown == press) return; // prevent repeats
+        if (axis.state != 0) {
+            axis.useMouse = (axis.state > 0) ? axis.puseMouse : axis.nuseMouse;
+        }
+        sendKey(axis, press, axis.useMouse);
+        axis.isDown = press;
+    }
+
+    //a gradient axis in keyboard mode holds the key down for part of every
+    //pwm cycle, but that is timed by the scheduler (AxisData::fire()).
+    static void update(AxisData &) {
+    }
+};
+
+//Mouse* and KeyboardAndMouse* modes: mouse movement along one direction, plus
+//a key past the extreme zone if Keys is set.
+template <bool Keys, bool Vertical, bool Reverse, bool Gradient, int Curve>
+struct MouseKernel {
+    // KeyboardAndMouse* modes - the key past the extreme zone
+    static void keys(AxisData &axis, bool press) {
+        const bool keyboardPress = press &&
+            (abs(axis.state) >= (axis.isDown ? axis.xRelease : axis.xZone));
+        const bool useMouse = (axis.state > 0) ? axis.puseMouse : axis.nuseMouse;
+
+        // if key not pressed, press it
+        if (keyboardPress && !axis.isDown) {
+            sendKey(axis, true, useMouse);
+            axis.isDown = true;
+        }
+        // if key should be released
+        else if (!keyboardPress && axis.isDown) {
+            sendKey(axis, false, useMouse);
+            axis.isDown = false;
+        }
+    }
+
+    static void move(AxisData &axis, bool press) {
+        if (Keys) keys(axis, press);
+
+        const int dist = mouseDistance<Gradient, Curve>(axis);
+        if (dist == 0) return;
+
+        FakeEvent e;
+        e.type = FakeEvent::MouseMove;
+        e.move.x = Vertical ? 0 : (Reverse ? -dist : dist);
+        e.move.y = Vertical ? (Reverse ? -dist : dist) : 0;
+        sendevent(e);
+    }
+
+    //the movement of gradient axes is done by their lane in the batch shared
+    //by all devices, only the key is left to do here. It only changes when
+    //the state does, so there's nothing to do between events.
+    static void update(AxisData &axis) {
+        if (Keys) keys(axis, true);
+    }
+};
+
+//Mouse* and KeyboardAndMouse* modes of absolute axes: the axis puts the
+//pointer somewhere on its monitor instead of moving it, with the center of
+//the monitor in the dead zone and the edges past the extreme zone.
+template <bool Keys, bool Vertical, bool Reverse>
+struct AbsoluteKernel {
+    typedef MouseKernel<Keys, Vertical, Reverse, true, AxisData::Linear> Relative;
+
+    static void move(AxisData &axis, bool press) {
+        if (Keys) Relative::keys(axis, press);
+    }
+
+    static void update(AxisData &axis) {
+        if (Keys) Relative::keys(axis, true);
+        int32_t u = fixUnit(abs(axis.state), axis.dZone, axis.xZone, axis.inverseRange);
+        if ((axis.state < 0) != Reverse) u = -u;
+        axis.pointers[axis.monitor].move(Vertical, u);
+    }
+};
+
+template <class Kernel>
+static inline void useKernel(AxisData &axis) {
+    axis.moveFn = &Kernel::move;
+    axis.updateFn = &Kernel::update;
+    axis.motionX = 0;
+    axis.motionY = 0;
+}
+
+//the transfer curve only matters for gradient axes
+template <bool Keys, bool Vertical, bool Reverse, bool Gradient>
+static inline void useMouseKernel(AxisData &axis) {
+    if (!Gradient) {
+        useKernel< MouseKernel<Keys, Vertical, Reverse, false, AxisData::Linear> >(axis);
+        return;
+    }
+    switch (axis.transferCurve) {
+    case AxisData::Linear:
+        useKernel< MouseKernel<Keys, Vertical, Reverse, Gradient, AxisData::Linear> >(axis);
+        break;
+    case AxisData::Quadratic:
+        useKernel< MouseKernel<Keys, Vertical, Reverse, Gradient, AxisData::Quadratic> >(axis);
+        break;
+    case AxisData::Cubic:
+        useKernel< MouseKernel<Keys, Vertical, Reverse, Gradient, AxisData::Cubic> >(axis);
+        break;
+    case AxisData::QuadraticExtreme:
+        useKernel< MouseKernel<Keys, Vertical, Reverse, Gradient, AxisData::QuadraticExtreme> >(axis);
+        break;
+    case AxisData::PowerFunction:
+        useKernel< MouseKernel<Keys, Vertical, Reverse, Gradient, AxisData::PowerFunction> >(axis);
+        break;
+    }
+}
+
+template <bool Keys, bool Vertical, bool Reverse>
+static inline void useMouseKernel(AxisData &axis) {
+    if (axis.absolute) {
+        useKernel< AbsoluteKernel<Keys, Vertical, Reverse> >(axis);
+    }
+    else if (axis.gradient) {
+        useMouseKernel<Keys, Vertical, Reverse, true>(axis);
+        const int sign = Reverse ? -1 : 1;
+        axis.motionX = Vertical ? 0 : sign;
+        axis.motionY = Vertical ? sign : 0;
+    }
+    else useMouseKernel<Keys, Vertical, Reverse, false>(axis);
+}
+
+void AxisData::configure() {
+    inverseRange = fixScale(dZone, xZone);
+    exponent = fixExponent(sensitivity);
+    //releasing further out than engaging would make no sense
+    dRelease = (dZoneRelease >= 0 && dZoneRelease < dZone) ? dZoneRelease : dZone;
+    xRelease = (xZoneRelease >= 0 && xZoneRelease < xZone) ? xZoneRelease : xZone;
+    filter.configure(filterCutoff, filterBeta);
+    settleDue = -1;
+    reschedule();
+    //the direction may have changed, so start over with a fresh lane
+    if (lane >= 0) {
+        MotionBatch::instance().releaseLane(lane);
+        lane = -1;
+    }
+    rest = 0;
+
+    switch (mode) {
+    case Keyboard:                useKernel<KeyboardKernel>(*this); break;
+    case MousePosVert:            useMouseKernel<false, true,  false>(*this); break;
+    case MouseNegVert:            useMouseKernel<false, true,  true >(*this); break;
+    case MousePosHor:             useMouseKernel<false, false, false>(*this); break;
+    case MouseNegHor:             useMouseKernel<false, false, true >(*this); break;
+    case KeyboardAndMouseHor:     useMouseKernel<true,  false, false>(*this); break;
+    case KeyboardAndMouseVert:    useMouseKernel<true,  true,  false>(*this); break;
+    case KeyboardAndMouseHorRev:  useMouseKernel<true,  false, true >(*this); break;
+    case KeyboardAndMouseVertRev: useMouseKernel<true,  true,  true >(*this); break;
+    }
+    updateLane();
+}
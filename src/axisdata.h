@@ -0,0 +1,167 @@
+#ifndef QJOYPAD_AXISDATA_H
+#define QJOYPAD_AXISDATA_H
+
+#include "constant.h"
+#include "scheduler.h"
+#include "filter.h"
+#include "fixedpoint.h"
+
+class MacroPlayer;
+struct AbsolutePointer;
+
+#define DZONE 3000
+#define XZONE 30000
+
+//the ways an axis can be interpreted. These are shared by the per-device
+//tables and by the Axis objects that edit them.
+struct AxisEnums {
+    enum Interpretation { ZeroOne, Gradient, AbsolutePos };
+
+    // Added new modes for extended axis handling:
+    enum Mode {
+        Keyboard,
+        MousePosVert,
+        MouseNegVert,
+        MousePosHor,
+        MouseNegHor,
+        KeyboardAndMouseHor,     // new mode: horizontal mouse movement + keys
+        KeyboardAndMouseVert,    // new mode: vertical mouse movement + keys
+        KeyboardAndMouseHorRev,
+        KeyboardAndMouseVertRev,
+    };
+
+    enum TransferCurve { Linear, Quadratic, Cubic, QuadraticExtreme, PowerFunction };
+};
+
+//everything needed to turn the events of one axis into fake events. A JoyPad
+//keeps these in one contiguous array indexed by js_event.number, so handling
+//an event doesn't have to chase pointers. The Axis objects are only views on
+//this for reading, writing and editing layouts. Gradient keyboard axes are
+//timed by the Scheduler, so a JoyPad must never let its table move.
+struct AxisData : public AxisEnums, public Scheduler::Entry {
+    AxisData();
+
+    //process an event from the actual joystick device, read at time (in
+    //milliseconds, js_event.time)
+    void jsevent(int value, uint32_t time);
+    //the next pwm edge of a gradient keyboard axis or the next step of a
+    //filter that hasn't caught up yet is due
+    void fire(int64_t now);
+    //releases any pushed keys and returns to a neutral state
+    void release();
+    //reset default settings
+    void toDefault();
+    //true iff this is currently using default settings
+    bool isDefault() const;
+    bool inDeadZone(int val) const;
+    //recalculate everything derived from the settings, including which of
+    //the specialized kernels handles this axis. Call whenever the settings
+    //change.
+    void configure();
+    //apply the throttle setting to a raw device value
+    int throttled(int value) const { return throttled(throttle, value); }
+    //the same for any throttle setting (-1, 0 or 1), for the editor
+    static int throttled(int throttle, int value);
+
+    //settings
+    Interpretation interpretation;
+    Mode mode;
+    TransferCurve transferCurve;
+    bool gradient;
+    bool absolute;
+    bool puseMouse;
+    bool nuseMouse;
+    int throttle;
+    int dZone;
+    int xZone;
+    //hysteresis: the axis turns on at dZone but only off again once it's
+    //back at dZoneRelease, and the key of the KeyboardAndMouse* modes is
+    //pressed at xZone but only released below xZoneRelease. -1 for the same
+    //as dZone or xZone.
+    int dZoneRelease;
+    int xZoneRelease;
+    int maxSpeed;
+    //a gradient keyboard axis holds its key down for part of every
+    //pwmPeriod milliseconds, in pwmLevels steps.
+    int pwmPeriod;
+    int pwmLevels;
+    //the monitor absolute axes put the mouse on, 0 for the whole screen
+    int monitor;
+    //the One-Euro filter applied to the axis before anything else, see
+    //filter.h. A cutoff of 0 means no filter.
+    float filterCutoff;
+    float filterBeta;
+    float sensitivity;
+    //fixScale() of the zones and fixExponent() of the sensitivity
+    int32_t inverseRange;
+    int64_t exponent;
+    //the release thresholds that are actually used, worked out by configure()
+    int dRelease;
+    int xRelease;
+    int pkeycode;
+    int nkeycode;
+    //the keysyms the keycodes were looked up for, 0 for plain keycodes
+    uint32_t pkeysym;
+    uint32_t nkeysym;
+    //the numbers of the macros to play instead of the keys, 0 for none
+    int pmacro;
+    int nmacro;
+    //and what plays them, set up by the JoyPad when a layout is loaded
+    MacroPlayer *pplayer;
+    MacroPlayer *nplayer;
+    //the pointers of the device, one for every monitor. An absolute axis
+    //moves pointers[monitor], set up by the JoyPad when the axis is made.
+    AbsolutePointer *pointers;
+
+    //current state
+    bool isOn;
+    bool isDown;
+    bool useMouse;
+    int state;
+    //when the pwm started, the current cycle, whether the next edge is the
+    //key release, and when it is due (-1 for none)
+    int64_t pwmStart;
+    int pwmCycle;
+    bool pwmReleaseDue;
+    int64_t pwmDue;
+    //the filter, and when it is stepped again (-1 for none). The pwm and the
+    //filter share the one Scheduler entry of the axis.
+    AxisFilter filter;
+    int64_t settleDue;
+    int downkey;
+    MacroPlayer *downplayer;
+    //the sub-pixel movement left over, in 1/2^REST_SHIFT pixel
+    int32_t rest;
+    //gradient mouse axes move the mouse through a lane in the MotionBatch
+    //(motion.h) while they are on, -1 otherwise. motionX and motionY say
+    //which way a positive value moves the mouse, and are 0 for axes that
+    //don't go through the batch.
+    int lane;
+    int motionX;
+    int motionY;
+
+    //the kernels for the current mode, interpretation and transfer curve, as
+    //picked by configure(). move() actually sends the key press/release or
+    //mouse movement, update() whatever else has to follow the state of a
+    //gradient axis while it is on. Absolute axes follow the state with
+    //update() all the time, dead zone included. Nothing an axis does needs a timer of its
+    //own: the mouse moves through the batch, pwm goes through the Scheduler.
+    typedef void (*MoveFn)(AxisData &axis, bool press);
+    typedef void (*UpdateFn)(AxisData &axis);
+    MoveFn moveFn;
+    UpdateFn updateFn;
+
+private:
+    void move(bool press) { moveFn(*this, press); }
+    //act on a new (filtered) value of the axis
+    void update(int value);
+    //press the key for one pwm cycle and schedule what comes next
+    void pwmPulse();
+    //the next pwm edge is due, now is the time it actually happens
+    void pwmEdge(int64_t now);
+    //schedule the axis for whichever of pwmDue and settleDue comes first
+    void reschedule();
+    void updateLane();
+};
+
+#endif
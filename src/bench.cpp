@@ -0,0 +1,517 @@
+//qjoypad-bench: microbenchmarks of the paths every event and every tick go
+//through, and of opening the editor, printed as JSON so runs can be
+//compared, with the cache misses per operation where the CPU counts them and
+//the size of the state tables of a device. Everything runs on the virtual
+//clock with the events going nowhere, so only the work QJoyPad does itself is
+//measured. Widgets are built on the offscreen platform unless
+//QT_QPA_PLATFORM says otherwise, with xcb the key names come from X.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/joystick.h>
+#include <linux/perf_event.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <QApplication>
+#include <QEvent>
+#include <QImage>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+#include "axis.h"
+#include "button.h"
+#include "joypad.h"
+#include "joypadw.h"
+#include "joyslider.h"
+#include "keycode.h"
+#include "motion.h"
+#include "event.h"
+#include "screen.h"
+#include "scheduler.h"
+
+//how many times a benchmark is timed, the fastest run counts
+#define BENCH_RUNS 5
+//how many ticks --check-kernels runs
+#define CHECK_TICKS 100000
+//the size of the pad the joypad benchmarks use
+#define BENCH_AXES 6
+#define BENCH_BUTTONS 8
+//how many of those pads the editor benchmarks show
+#define BENCH_PADS 4
+
+//throws the events away
+class NullSink : public EventSink {
+    public:
+        NullSink() : count(0) {}
+        void event(const FakeEvent &) { ++ count; }
+        long count;
+};
+
+static VirtualClock virtualClock;
+//keeps the compiler from dropping work whose result isn't used
+static volatile int benchSink;
+
+static uint64_t nsecNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+//something to time: run() does one operation, i is how many came before
+class Benchmark {
+    public:
+        Benchmark(const QString &name) : name(name) {}
+        virtual ~Benchmark() {}
+        virtual void run(long i) = 0;
+        QString name;
+};
+
+struct Result {
+    QString name;
+    long iterations;
+    double nsMin;
+    double nsMedian;
+    //over all timed runs, or -1 without a hardware counter
+    double missesPerOp;
+};
+
+//counts the cache misses of this process through perf_event_open(). Not
+//every machine has the counter, or lets us have it (perf_event_paranoid),
+//then the misses are left out.
+class CacheMisses {
+    public:
+        CacheMisses() {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        ~CacheMisses() { if (fd >= 0) close(fd); }
+        bool available() const { return fd >= 0; }
+        uint64_t read() const {
+            uint64_t count = 0;
+            if (fd < 0 || ::read(fd, &count, sizeof(count)) != sizeof(count)) return 0;
+            return count;
+        }
+    private:
+        int fd;
+};
+
+static CacheMisses *cacheMisses;
+
+//time bench for at least minTime ms per run
+static Result measure(Benchmark &bench, int minTime) {
+    //find an iteration count that takes long enough
+    long iterations = 1;
+    long done = 0;
+    for (;;) {
+        const uint64_t start = nsecNow();
+        for (long i = 0; i < iterations; ++ i) bench.run(done + i);
+        done += iterations;
+        if (nsecNow() - start >= uint64_t(minTime) * 1000000 || iterations >= (1L << 40)) break;
+        iterations *= 2;
+    }
+    std::vector<double> times;
+    const uint64_t missesBefore = cacheMisses->read();
+    for (int r = 0; r < BENCH_RUNS; ++ r) {
+        const uint64_t start = nsecNow();
+        for (long i = 0; i < iterations; ++ i) bench.run(done + i);
+        done += iterations;
+        times.push_back(double(nsecNow() - start) / iterations);
+    }
+    const uint64_t misses = cacheMisses->read() - missesBefore;
+    std::sort(times.begin(), times.end());
+    Result result;
+    result.name = bench.name;
+    result.iterations = iterations;
+    result.nsMin = times.front();
+    result.nsMedian = times[times.size() / 2];
+    result.missesPerOp = cacheMisses->available() ?
+        double(misses) / (double(iterations) * BENCH_RUNS) : -1.0;
+    return result;
+}
+
+//a value that sweeps an axis back and forth, through the dead zone
+static inline int sweep(long i) {
+    const int step = int(i % 256);
+    return ((step < 128) ? step : 255 - step) * 512 - JOYMAX;
+}
+
+//AxisData::jsevent, and one tick of whatever the axis keeps running
+class AxisBench : public Benchmark {
+    public:
+        AxisBench(const QString &name, AxisData::Mode mode, bool gradient,
+                  AxisData::TransferCurve curve)
+            : Benchmark(name), table(1) {
+            AxisData &axis = table[0];
+            axis.mode = mode;
+            axis.gradient = gradient;
+            axis.interpretation = gradient ? AxisData::Gradient : AxisData::ZeroOne;
+            axis.transferCurve = curve;
+            axis.sensitivity = 2.0F;
+            axis.pkeycode = 38;
+            axis.nkeycode = 40;
+            axis.configure();
+        }
+        ~AxisBench() { table[0].release(); }
+        void run(long i) {
+            table[0].jsevent(sweep(i), uint32_t(virtualClock.now()));
+            Scheduler::instance().runUntil(&virtualClock, virtualClock.now() + MSEC);
+        }
+    private:
+        QVector<AxisData> table;
+};
+
+//ButtonData::jsevent, pressed and released in turn. Rapidfire fires while
+//the clock moves on.
+class ButtonBench : public Benchmark {
+    public:
+        ButtonBench(const QString &name, bool sticky, bool rapidfire)
+            : Benchmark(name), table(1) {
+            ButtonData &button = table[0];
+            button.keycode = 38;
+            button.sticky = sticky;
+            button.rapidfire = rapidfire;
+        }
+        ~ButtonBench() { table[0].release(); }
+        void run(long i) {
+            benchSink = table[0].jsevent(int(i & 1));
+            Scheduler::instance().runUntil(&virtualClock, virtualClock.now() + 5);
+        }
+    private:
+        QVector<ButtonData> table;
+};
+
+//reads the definition of a pad, as it comes after "Joystick 1"
+static void readDefinition(JoyPad *joypad, const QString &layout) {
+    QString text = layout;
+    QTextStream stream(&text);
+    QString word;
+    stream >> word >> word >> word;
+    joypad->readConfig(stream);
+}
+
+//JoyPad::jsevent, for a mix of axis, stick and button events
+class JoyPadBench : public Benchmark {
+    public:
+        JoyPadBench(const QString &name, const QString &layout)
+            : Benchmark(name), joypad(0, -1, 0) {
+            readDefinition(&joypad, layout);
+        }
+        ~JoyPadBench() { joypad.release(); }
+        void run(long i) {
+            js_event msg;
+            msg.time = uint32_t(virtualClock.now());
+            if (i % 3 == 2) {
+                msg.type = JS_EVENT_BUTTON;
+                msg.number = (i / 3) % BENCH_BUTTONS;
+                msg.value = (i / (3 * BENCH_BUTTONS)) & 1;
+            }
+            else {
+                msg.type = JS_EVENT_AXIS;
+                msg.number = (i / 3) % BENCH_AXES;
+                msg.value = sweep(i);
+            }
+            joypad.replay(&msg, 1);
+            Scheduler::instance().runUntil(&virtualClock, virtualClock.now() + 1);
+        }
+    private:
+        JoyPad joypad;
+};
+
+//the pages the editor shows for BENCH_PADS pads, with the label of every
+//control, built and thrown away again. With newKeymap the key names are
+//looked up again first, as on the first open after the keyboard mapping
+//changed.
+class EditorBench : public Benchmark {
+    public:
+        EditorBench(const QString &name, const QString &layout, bool newKeymap)
+            : Benchmark(name), newKeymap(newKeymap) {
+            for (int p = 0; p < BENCH_PADS; ++ p) {
+                joypads.append(new JoyPad(p, -1, 0));
+                readDefinition(joypads[p], layout);
+            }
+        }
+        ~EditorBench() { qDeleteAll(joypads); }
+        void run(long) {
+            if (newKeymap) invalidateKeymap();
+            QWidget window;
+            for (int p = 0; p < joypads.size(); ++ p) {
+                joypads[p]->widget(&window, p);
+            }
+        }
+    private:
+        bool newKeymap;
+        QList<JoyPad*> joypads;
+};
+
+//JoySlider::setValue() and painting the slider, which the editor does for
+//every axis that moves. With uncached the boxes and tabs are drawn again
+//every time, as they were before the slider kept them in pixmaps.
+class SliderBench : public Benchmark {
+    public:
+        SliderBench(const QString &name, bool uncached)
+            : Benchmark(name), uncached(uncached), slider(3000, 30000, 0, 0),
+              image(300, 20, QImage::Format_ARGB32_Premultiplied) {
+            slider.resize(image.size());
+        }
+        void run(long i) {
+            slider.setValue(sweep(i));
+            if (uncached) {
+                //the slider draws everything again when its palette changes
+                QEvent change(QEvent::PaletteChange);
+                QApplication::sendEvent(&slider, &change);
+            }
+            slider.render(&image);
+        }
+    private:
+        bool uncached;
+        JoySlider slider;
+        QImage image;
+};
+
+//Axis::read and Button::read of one layout line, JoyPad::readConfig of a
+//whole definition
+class ReadBench : public Benchmark {
+    public:
+        enum What { AxisLine, ButtonLine, Definition };
+        ReadBench(const QString &name, What what, const QString &text)
+            : Benchmark(name), what(what), text(text),
+              axisTable(1), buttonTable(1), axis(0, &axisTable), button(0, &buttonTable),
+              joypad(0, -1, 0) {}
+        void run(long) {
+            QString copy = text;
+            QTextStream stream(&copy);
+            switch (what) {
+            case AxisLine: benchSink = axis.read(stream); break;
+            case ButtonLine: benchSink = button.read(stream); break;
+            case Definition: benchSink = joypad.readConfig(stream); break;
+            }
+        }
+    private:
+        What what;
+        QString text;
+        QVector<AxisData> axisTable;
+        QVector<ButtonData> buttonTable;
+        Axis axis;
+        Button button;
+        JoyPad joypad;
+};
+
+class KtosBench : public Benchmark {
+    public:
+        KtosBench() : Benchmark("ktos") {}
+        void run(long i) { benchSink = ktos(8 + int(i % 248)).size(); }
+};
+
+class SendBench : public Benchmark {
+    public:
+        SendBench() : Benchmark("sendevent/null") {}
+        void run(long i) {
+            FakeEvent e;
+            e.type = FakeEvent::MouseMove;
+            e.move.x = int(i & 7);
+            e.move.y = 1;
+            sendevent(e);
+        }
+};
+
+//what the layout line of axis or button says after "Axis n:"
+static QString axisLine(AxisData::Mode mode, bool gradient, AxisData::TransferCurve curve) {
+    QVector<AxisData> table(1);
+    table[0].mode = mode;
+    table[0].gradient = gradient;
+    table[0].interpretation = gradient ? AxisData::Gradient : AxisData::ZeroOne;
+    table[0].transferCurve = curve;
+    table[0].pkeycode = 38;
+    table[0].nkeycode = 40;
+    table[0].configure();
+    QString text;
+    QTextStream stream(&text);
+    Axis(0, &table).write(stream);
+    stream.flush();
+    return text.mid(text.indexOf(':') + 1);
+}
+
+static QString buttonLine(bool sticky, bool rapidfire) {
+    QVector<ButtonData> table(1);
+    table[0].keycode = 38;
+    table[0].sticky = sticky;
+    table[0].rapidfire = rapidfire;
+    QString text;
+    QTextStream stream(&text);
+    Button(0, &table).write(stream);
+    stream.flush();
+    return text.mid(text.indexOf(':') + 1);
+}
+
+//text as a JSON string. Names are plain ASCII now, but a filter or a name
+//with a quote in it must not break the output.
+static void printJsonString(FILE *out, const QString &text) {
+    const QByteArray utf8 = text.toUtf8();
+    fputc('"', out);
+    for (int i = 0; i < utf8.size(); ++ i) {
+        const unsigned char c = utf8[i];
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 0x20) fprintf(out, "\\u%04x", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void printJson(FILE *out, const std::vector<Result> &results) {
+    //the state tables of one device, for the pad of joypad/jsevent
+    fprintf(out, "{\n  \"memory\": {\"axis_bytes\": %d, \"button_bytes\": %d, \"stick_bytes\": %d, \"device_bytes\": %d},\n",
+            int(sizeof(AxisData)), int(sizeof(ButtonData)), int(sizeof(StickData)),
+            int(BENCH_AXES * sizeof(AxisData) + BENCH_BUTTONS * sizeof(ButtonData)));
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++ i) {
+        const Result &r = results[i];
+        fprintf(out, "    {\"name\": ");
+        printJsonString(out, r.name);
+        fprintf(out, ", \"iterations\": %ld, \"ns_per_op\": %.2f, \"ns_per_op_median\": %.2f, ",
+                r.iterations, r.nsMin, r.nsMedian);
+        if (r.missesPerOp >= 0) fprintf(out, "\"cache_misses_per_op\": %.3f}", r.missesPerOp);
+        else fprintf(out, "\"cache_misses_per_op\": null}");
+        fprintf(out, "%s\n", (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+    //the editor benchmarks build widgets, but nothing is ever shown
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty()) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QString filter;
+    int minTime = 100;
+    bool checkKernels = false;
+
+    struct option long_options[] = {
+        {"help",          no_argument,       0, 'h'},
+        {"filter",        required_argument, 0, 'f'},
+        {"time",          required_argument, 0, 't'},
+        {"check-kernels", no_argument,       0, 'k'},
+        {0,               0,                 0,  0 }
+    };
+
+    for (;;) {
+        int c = getopt_long(argc, argv, "hf:t:k", long_options, NULL);
+        if (c == -1) break;
+
+        switch (c) {
+            case 'h':
+                printf("Usage: %s [--filter=TEXT] [--time=MS] [--check-kernels]\n"
+                       "\n"
+                       "Run the microbenchmarks and print the results as JSON.\n"
+                       "\n"
+                       "Options:\n"
+                       "  -h, --help            Print this help message.\n"
+                       "  -f, --filter=TEXT     Only run benchmarks with TEXT in their name.\n"
+                       "  -t, --time=MS         Time every run of a benchmark for at least\n"
+                       "                        this long (default 100).\n"
+                       "  -k, --check-kernels   Instead, run every motion kernel this CPU\n"
+                       "                        can run on the same lanes as a plain int64\n"
+                       "                        version, and fail if any result differs.\n", argv[0]);
+                return 0;
+
+            case 'f':
+                filter = optarg;
+                break;
+
+            case 't':
+                minTime = atoi(optarg);
+                break;
+
+            case 'k':
+                checkKernels = true;
+                break;
+
+            default:
+                fprintf(stderr, "See `%s --help` for more information\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (checkKernels) {
+        const std::vector<MotionBatch::KernelCheck> checks = MotionBatch::checkKernels(CHECK_TICKS);
+        bool same = true;
+        for (size_t k = 0; k < checks.size(); ++ k) {
+            printf("%s: %ld lane results differ\n", checks[k].name, checks[k].mismatches);
+            same = same && checks[k].mismatches == 0;
+        }
+        return same ? 0 : 1;
+    }
+
+    Scheduler::instance().setClock(&virtualClock);
+    CacheMisses misses;
+    cacheMisses = &misses;
+    NullSink sink;
+    setEventSink(&sink);
+    setScreenSize(1920, 1080);
+
+    static const struct { const char *name; AxisData::Mode mode; } modes[] = {
+        {"keyboard", AxisData::Keyboard},
+        {"mouse", AxisData::MousePosHor},
+        {"keyboard+mouse", AxisData::KeyboardAndMouseHor}
+    };
+    static const char *curves[] = {
+        "linear", "quadratic", "cubic", "quadratic-extreme", "power"
+    };
+
+    std::vector<Benchmark*> benches;
+    QString definition = "Joystick 1 {\n";
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++ m) {
+        benches.push_back(new AxisBench(QString("axis/%1/zeroone").arg(modes[m].name),
+                                        modes[m].mode, false, AxisData::Linear));
+        for (int c = AxisData::Linear; c <= AxisData::PowerFunction; ++ c) {
+            benches.push_back(new AxisBench(QString("axis/%1/%2").arg(modes[m].name, curves[c]),
+                                            modes[m].mode, true, AxisData::TransferCurve(c)));
+        }
+        definition += QString("\tAxis %1:").arg(2 * m + 1) +
+                      axisLine(modes[m].mode, false, AxisData::Linear);
+        definition += QString("\tAxis %1:").arg(2 * m + 2) +
+                      axisLine(modes[m].mode, true, AxisData::Quadratic);
+    }
+    benches.push_back(new ButtonBench("button/plain", false, false));
+    benches.push_back(new ButtonBench("button/sticky", true, false));
+    benches.push_back(new ButtonBench("button/rapidfire", false, true));
+    for (int b = 0; b < BENCH_BUTTONS; ++ b) {
+        definition += QString("\tButton %1:").arg(b + 1) + buttonLine(b % 4 == 1, b % 4 == 2);
+    }
+    definition += "}\n";
+
+    benches.push_back(new JoyPadBench("joypad/jsevent", definition));
+    benches.push_back(new ReadBench("read/axis", ReadBench::AxisLine,
+                                    axisLine(AxisData::KeyboardAndMouseHor, true, AxisData::Cubic)));
+    benches.push_back(new ReadBench("read/button", ReadBench::ButtonLine, buttonLine(false, true)));
+    //readConfig() starts after "Joystick 1 {"
+    benches.push_back(new ReadBench("read/joypad", ReadBench::Definition,
+                                    definition.mid(definition.indexOf('{') + 1)));
+    benches.push_back(new KtosBench());
+    benches.push_back(new EditorBench("editor/open", definition, false));
+    benches.push_back(new EditorBench("editor/open-new-keymap", definition, true));
+    benches.push_back(new SliderBench("editor/slider", false));
+    benches.push_back(new SliderBench("editor/slider-uncached", true));
+    benches.push_back(new SendBench());
+
+    std::vector<Result> results;
+    foreach (Benchmark *bench, benches) {
+        if (filter.isEmpty() || bench->name.contains(filter)) {
+            results.push_back(measure(*bench, minTime));
+        }
+    }
+    qDeleteAll(benches.begin(), benches.end());
+    printJson(stdout, results);
+    return 0;
+}
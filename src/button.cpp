@@ -1,18 +1,8 @@
 #include "button.h"
-#include "event.h"
+#include "macro.h"
 
-Button::Button( int i, QObject *parent ) : QObject(parent) {
-    index = i;
-    isButtonPressed = false;
-    isDown = false;
-    rapidfire = false;
-    hasLayout = false;
-    toDefault();
-    tick = 0;
-}
-
-Button::~Button() {
-    release();
+Button::Button( int i, QVector<ButtonData> *table, QObject *parent )
+    : QObject(parent), index(i), table(table) {
 }
 
 bool Button::read( QTextStream &stream ) {
@@ -23,6 +13,7 @@ bool Button::read( QTextStream &stream ) {
     QRegExp regex("[\\s,]+");
     QStringList words = input.split(regex);
 
+    ButtonData &d = data();
     //used to assure correct conversion of QStrings -> ints
     bool ok;
     //used to receive converted ints from QStrings.
@@ -35,115 +26,90 @@ bool Button::read( QTextStream &stream ) {
             if (it == words.end()) return false;
             val = (*it).toInt(&ok);
             if (ok && val >= 0 && val <= MAXKEY) {
-                useMouse = true;
-                keycode = val;
+                d.useMouse = true;
+                d.keycode = val;
+                d.keysym = 0;
             }
             else return false;
         }
         else if (QString::compare(*it, "key", Qt::CaseInsensitive) == 0) {
             ++it;
             if (it == words.end()) return false;
-            val = (*it).toInt(&ok);
-            if (ok && val >= 0 && val <= MAXKEY) {
-                useMouse = false;
-                keycode = val;
-            }
+            if (readKey(*it, &d.keycode, &d.keysym)) d.useMouse = false;
             else return false;
         }
         else if (QString::compare(*it, "layout", Qt::CaseInsensitive) == 0) {
             ++it;
             if (it == words.end()) return false;
             layout = (*it).replace("\\s", " ");
-            hasLayout = true;
+            d.hasLayout = true;
+        }
+        else if (QString::compare(*it, "macro", Qt::CaseInsensitive) == 0) {
+            ++it;
+            if (it == words.end()) return false;
+            val = (*it).toInt(&ok);
+            if (ok && val > 0) d.macro = val;
+            else return false;
         }
         else if (QString::compare(*it, "rapidfire", Qt::CaseInsensitive) == 0) {
-            rapidfire = true;
+            d.rapidfire = true;
+        }
+        else if (QString::compare(*it, "rate", Qt::CaseInsensitive) == 0) {
+            ++it;
+            if (it == words.end()) return false;
+            val = (*it).toInt(&ok);
+            if (ok && val > 0 && val <= RAPIDFIRE_MAXRATE) d.rapidRate = val;
+            else return false;
+        }
+        else if (QString::compare(*it, "duty", Qt::CaseInsensitive) == 0) {
+            ++it;
+            if (it == words.end()) return false;
+            val = (*it).toInt(&ok);
+            if (ok && val > 0 && val < 100) d.rapidDuty = val;
+            else return false;
         }
         else if (QString::compare(*it, "sticky", Qt::CaseInsensitive) == 0) {
-            sticky = true;
+            d.sticky = true;
         }
     }
     return true;
 }
 
 void Button::write( QTextStream &stream ) {
+    const ButtonData &d = data();
     stream << "\tButton " << (index+1) << ": ";
-    if (rapidfire) stream << "rapidfire, ";
-    if (sticky) stream << "sticky, ";
-    stream << (useMouse ? "mouse " : "key ") << keycode;
-    if (hasLayout) stream << " layout " << layout.replace(" ", "\\s");
+    if (d.rapidfire) stream << "rapidfire, ";
+    if (d.rapidRate != RAPIDFIRE_RATE) stream << "rate " << d.rapidRate << ", ";
+    if (d.rapidDuty != RAPIDFIRE_DUTY) stream << "duty " << d.rapidDuty << ", ";
+    if (d.sticky) stream << "sticky, ";
+    if (d.useMouse) stream << "mouse " << d.keycode;
+    else stream << "key " << keyString(d.keycode, d.keysym);
+    if (d.hasLayout) stream << " layout " << layout.replace(" ", "\\s");
+    if (d.macro > 0) stream << " macro " << d.macro;
     stream << "\n";
 }
 
 void Button::release() {
-    if (isDown) {
-        click(false);
-        isDown = true;
-    }
+    data().release();
 }
 
 void Button::jsevent( int value ) {
-    if (hasLayout) {
-        if (value == 1 && !isButtonPressed) {
-            isButtonPressed = 1;
-            //Change layout
-            emit loadLayout(layout);
-        }
-        else if (value == 0) {
-            isButtonPressed = 0;
-        }
-        return;
+    if (data().jsevent(value)) {
+        triggerLayout();
     }
+}
 
-    bool newval = (value == 1);
-    if (sticky) {
-        //the state of a sticky key only changes on button press, not button release.
-        if (value == 1) {
-            isButtonPressed = !isButtonPressed;
-        }
-        else return;
-    }
-    //if the received event indicates a change in state,
-    else if (newval != isButtonPressed) {
-        isButtonPressed = newval; //change state
-        if (isButtonPressed && rapidfire) {
-            tick = 0;
-            connect(&timer, SIGNAL(timeout()), this, SLOT(timerCalled()));
-            timer.start(MSEC);
-        }
-        if (!isButtonPressed && rapidfire) {
-            timer.stop();
-            disconnect(&timer, SIGNAL(timeout()), 0, 0);
-            if(isDown) {
-                click(false);
-            }
-            tick = 0;
-        }
-    }
-    //otherwise... we don't care. This shouldn't happen.
-    else return;
-    //if rapidfire is on, then timer() will do its job. Otherwise we must
-    //manually triger the key event.
-    if (!rapidfire) {
-        click(isButtonPressed);
-    }
+void Button::triggerLayout() {
+    //Change layout
+    emit loadLayout(layout);
 }
 
 void Button::toDefault() {
-    rapidfire = false;
-    sticky = false;
-    useMouse = false;
-    keycode = 0;
-    hasLayout = false;
-    timer.stop();
+    data().toDefault();
 }
 
 bool Button::isDefault() {
-    return	(rapidfire == false) &&
-           (sticky == false) &&
-           (useMouse == false) &&
-           (keycode == 0) &&
-           (hasLayout == false);
+    return data().isDefault();
 }
 
 QString Button::getName() {
@@ -151,48 +117,34 @@ QString Button::getName() {
 }
 
 QString Button::status() {
-    if (hasLayout) {
+    const ButtonData &d = data();
+    if (d.hasLayout) {
         return tr("%1 : %2").arg(getName(), layout);
     }
-    else if (useMouse) {
-        return tr("%1 : Mouse %2").arg(getName()).arg(keycode);
+    else if (d.macro > 0) {
+        return tr("%1 : Macro %2").arg(getName()).arg(d.macro);
+    }
+    else if (d.useMouse) {
+        return tr("%1 : Mouse %2").arg(getName()).arg(d.keycode);
     }
     else {
-        return tr("%1 : %2").arg(getName(), ktos(keycode));
+        return tr("%1 : %2").arg(getName(), ktos(d.keycode));
     }
 }
 
 void Button::setKey( bool mouse, int value ) {
-    useMouse = mouse;
-    keycode = value;
-}
-
-void Button::timerTick( int tick ) {
-    if (isButtonPressed) {
-        //originally I just clicked true and then false right after, but this
-        //was not recognized by some programs. I need a delay in between.
-        if (tick % FREQ == 0) {
-            click(true);
-        }
-        if (tick % FREQ == FREQ / 2) {
-            click(false);
+    ButtonData &d = data();
+    //a key picked for a button that plays a macro takes the macro's place,
+    //otherwise the macro would keep playing instead of it
+    if (d.macro > 0 && (mouse != d.useMouse || value != d.keycode)) {
+        d.macro = 0;
+        if (d.player) {
+            d.player->stop();
+            d.player = 0;
         }
     }
-}
-
-void Button::click( bool press ) {
-    if (isDown == press) return;
-    isDown = press;
-    FakeEvent click;
-    //determine which of the four possible events we're sending.
-    if (press) click.type = useMouse ? FakeEvent::MouseDown : FakeEvent::KeyDown;
-    else click.type = useMouse ? FakeEvent::MouseUp : FakeEvent::KeyUp;
-    //set up the event,
-    click.keycode = keycode;
-    //and send it.
-    sendevent(click);
-}
-
-void Button::timerCalled() {
-    timerTick(++tick);
+    //a keysym from the layout stays as long as its key is kept
+    if (mouse || value != d.keycode) d.keysym = 0;
+    d.useMouse = mouse;
+    d.keycode = value;
 }
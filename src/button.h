@@ -1,21 +1,24 @@
 #ifndef QJOYPAD_BUTTON_H
 #define QJOYPAD_BUTTON_H
 
-#include <QTimer>
+#include <QObject>
 #include <QTextStream>
+#include <QVector>
 
+#include "buttondata.h"
 
 //for getting a key name in status()
 #include "keycode.h"
 
+//a view on one entry of a JoyPad's button table. The table is what processes
+//events, this is what reads, writes and edits its settings.
 //note that the Button class, unlike the axis class, does not need a release
 //function because it releases the key as soon as it is pressed.
 class Button : public QObject {
 	Q_OBJECT
     friend class ButtonEdit;
 	public:
-		Button( int i, QObject *parent = 0 );
-		~Button();
+		Button( int i, QVector<ButtonData> *table, QObject *parent = 0 );
 		//read from stream
 		bool read( QTextStream &stream );
 		//write to stream
@@ -34,30 +37,16 @@ class Button : public QObject {
 		QString status();
 		//set the key code for this axis. Used by quickset.
 		void setKey(bool mouse, int value);
-		//happens every MSEC (constant.h) milliseconds
-		void timerTick( int tick );
+		//ask for this button's layout to be loaded
+		void triggerLayout();
         int buttonIndex() const { return index; }
+        ButtonData &data() { return (*table)[index]; }
 	protected:
-		//true iff this button is physically depressed.
-		bool isButtonPressed;
 		//the index of this button on the joystick
 		int index;
-		//actually sends a key press/release
-		virtual void click( bool press );
-		//is a simulated key currently depressed?
-		bool isDown;
-        int tick;
-		//button settings
-		bool rapidfire;
-		bool sticky;
-		bool useMouse;
-        int keycode;
-        QTimer timer;
+		QVector<ButtonData> *table;
 		//Layout settings
-		bool hasLayout;
 		QString layout;
-    public slots:
-        void timerCalled();
 	signals:
 		void loadLayout(QString name);
 };
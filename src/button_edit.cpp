@@ -16,15 +16,19 @@ ButtonEdit::ButtonEdit(Button* butt, const QStringList *layoutNames)
     v->setMargin(5);
     v->setSpacing(5);
 
-    btnKey = new KeyButton( button->getName(), button->keycode, this, true, button->useMouse);
+    btnKey = new KeyButton( button->getName(), button->data().keycode, this, true, button->data().useMouse);
+    if (button->data().macro > 0) {
+        //picking a key replaces the macro, see Button::setKey()
+        btnKey->setToolTip(tr("Plays Macro %1 until a key is picked").arg(button->data().macro));
+    }
     v->addWidget(btnKey);
 
     QHBoxLayout* h = new QHBoxLayout();
     chkSticky = new QCheckBox(tr("&Sticky"), this);
-    chkSticky->setChecked(button->sticky);
+    chkSticky->setChecked(button->data().sticky);
     h->addWidget(chkSticky);
     chkRapid = new QCheckBox(tr("&Rapid Fire"), this);
-    chkRapid->setChecked(button->rapidfire);
+    chkRapid->setChecked(button->data().rapidfire);
     h->addWidget(chkRapid);
     v->addLayout(h);
 
@@ -34,7 +38,7 @@ ButtonEdit::ButtonEdit(Button* butt, const QStringList *layoutNames)
         cmbLayout->addItem(layout, layout);
     }
     //Keep selected layout (if any)
-    if (button->hasLayout) {
+    if (button->data().hasLayout) {
         cmbLayout->setCurrentIndex(layoutNames->indexOf(button->layout) + 1);
     }
     else {
@@ -61,17 +65,16 @@ void ButtonEdit::accept() {
     else {
     	if (CRapid->isChecked()) takeTimer(button);
     }*/
-    button->rapidfire = chkRapid->isChecked();
-    button->sticky = chkSticky->isChecked();
+    button->data().rapidfire = chkRapid->isChecked();
+    button->data().sticky = chkSticky->isChecked();
     //if the user chose a mouse button...
-    button->useMouse = btnKey->choseMouse();
-    button->keycode = btnKey->getValue();
+    button->setKey(btnKey->choseMouse(), btnKey->getValue());
     if (cmbLayout->currentIndex() != 0) {
-        button->hasLayout = true;
+        button->data().hasLayout = true;
         button->layout = cmbLayout->currentText();
     }
     else {
-        button->hasLayout = false;
+        button->data().hasLayout = false;
     }
 
     QDialog::accept();
@@ -0,0 +1,173 @@
+#include "buttondata.h"
+#include "event.h"
+#include "macro.h"
+
+ButtonData::ButtonData() {
+    isButtonPressed = false;
+    isDown = false;
+    rapidfire = false;
+    hasLayout = false;
+    player = 0;
+    rapidStart = 0;
+    rapidCycle = 0;
+    toDefault();
+}
+
+void ButtonData::release() {
+    if (player) {
+        player->stop();
+    }
+    Scheduler::instance().cancel(this);
+    if (isDown) {
+        click(false);
+        isDown = false;
+    }
+}
+
+void ButtonData::resync( bool pressed ) {
+    //a sticky button keeps its state on purpose, and only presses change it.
+    //Those are lost, there's no telling what happened.
+    if (sticky || pressed == isButtonPressed) return;
+    if (pressed) {
+        //the press was missed. It's not played back now, but the release
+        //that is still to come is handled like any other.
+        isButtonPressed = true;
+        return;
+    }
+    //the release was missed, let go of whatever it holds
+    jsevent(0);
+}
+
+bool ButtonData::jsevent( int value ) {
+    if (hasLayout) {
+        if (value == 1 && !isButtonPressed) {
+            isButtonPressed = 1;
+            //Change layout
+            return true;
+        }
+        else if (value == 0) {
+            isButtonPressed = 0;
+        }
+        return false;
+    }
+
+    if (player) {
+        //the macro takes the place of the key
+        if (value == 1 && !isButtonPressed) {
+            isButtonPressed = true;
+            player->press();
+        }
+        else if (value == 0 && isButtonPressed) {
+            isButtonPressed = false;
+            player->release();
+        }
+        return false;
+    }
+
+    bool newval = (value == 1);
+    if (sticky) {
+        //the state of a sticky key only changes on button press, not button release.
+        if (value == 1) {
+            isButtonPressed = !isButtonPressed;
+        }
+        else return false;
+    }
+    //if the received event indicates a change in state,
+    else if (newval != isButtonPressed) {
+        isButtonPressed = newval; //change state
+    }
+    //otherwise... we don't care. This shouldn't happen.
+    else return false;
+
+    if (rapidfire) {
+        Scheduler &scheduler = Scheduler::instance();
+        if (isButtonPressed) {
+            //the first press happens right away, fire() does the rest
+            rapidStart = scheduler.now();
+            rapidCycle = 0;
+            click(true);
+            scheduler.schedule(this, rapidDeadline(false));
+        }
+        else {
+            scheduler.cancel(this);
+            click(false);
+        }
+    }
+    else {
+        click(isButtonPressed);
+    }
+    return false;
+}
+
+int64_t ButtonData::rapidDeadline(bool press) const {
+    //worked out from when rapidfire started, so rounding doesn't add up over
+    //the cycles. A release is due duty percent into the cycle.
+    const int64_t percent = int64_t(rapidCycle) * 100 + (press ? 100 : rapidDuty);
+    return rapidStart + percent * 10 / rapidRate;
+}
+
+void ButtonData::fire(int64_t now) {
+    //originally I just clicked true and then false right after, but this
+    //was not recognized by some programs. I need a delay in between.
+    const bool pressNext = isDown;
+    if (isDown) {
+        click(false);
+    }
+    else {
+        ++ rapidCycle;
+        click(true);
+    }
+    if (rapidDeadline(pressNext) <= now) {
+        //we fell behind (the event loop was blocked, or the machine slept).
+        //Rather than sending every edge that was missed in one burst, start
+        //the cycles over so this edge was on time.
+        rapidCycle = 0;
+        rapidStart = pressNext ? now - int64_t(rapidDuty) * 10 / rapidRate : now;
+    }
+    int64_t due = rapidDeadline(pressNext);
+    //at high rates part of a cycle can round down to nothing
+    if (due <= now) due = now + 1;
+    Scheduler::instance().schedule(this, due);
+}
+
+void ButtonData::toDefault() {
+    Scheduler::instance().cancel(this);
+    rapidfire = false;
+    rapidRate = RAPIDFIRE_RATE;
+    rapidDuty = RAPIDFIRE_DUTY;
+    sticky = false;
+    useMouse = false;
+    keycode = 0;
+    keysym = 0;
+    hasLayout = false;
+    macro = 0;
+    if (player) {
+        player->stop();
+        player = 0;
+    }
+}
+
+bool ButtonData::isDefault() const {
+    return	(rapidfire == false) &&
+           (rapidRate == RAPIDFIRE_RATE) &&
+           (rapidDuty == RAPIDFIRE_DUTY) &&
+           (sticky == false) &&
+           (useMouse == false) &&
+           (keycode == 0) &&
+           (keysym == 0) &&
+           (hasLayout == false) &&
+           (macro == 0);
+}
+
+void ButtonData::click( bool press ) {
+    if (isDown == press) return;
+    isDown = press;
+    FakeEvent click;
+    //determine which of the four possible events we're sending.
+    if (press) click.type = useMouse ? FakeEvent::MouseDown : FakeEvent::KeyDown;
+    else click.type = useMouse ? FakeEvent::MouseUp : FakeEvent::KeyUp;
+    //set up the event,
+    click.keycode = keycode;
+    //and send it.
+    sendevent(click);
+}
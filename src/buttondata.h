@@ -0,0 +1,67 @@
+#ifndef QJOYPAD_BUTTONDATA_H
+#define QJOYPAD_BUTTONDATA_H
+
+#include <stdint.h>
+
+#include "constant.h"
+#include "scheduler.h"
+
+class MacroPlayer;
+
+//everything needed to turn the events of one button into fake events. A
+//JoyPad keeps these in one contiguous array indexed by js_event.number. The
+//Button objects are only views on this for reading, writing and editing
+//layouts. Rapidfire is timed by the Scheduler, so a JoyPad must never let
+//its table move while a button is held.
+struct ButtonData : public Scheduler::Entry {
+    ButtonData();
+
+    //process an event from the actual joystick device. Returns true iff the
+    //button wants its layout to be loaded.
+    bool jsevent(int value);
+    //bring the button in line with the state the device reported after
+    //events were lost
+    void resync(bool pressed);
+    //the next rapidfire press or release is due
+    void fire(int64_t now);
+    //releases any pushed buttons and returns to a neutral state
+    void release();
+    //reset default settings
+    void toDefault();
+    //true iff this is currently using default settings
+    bool isDefault() const;
+
+    //settings
+    bool rapidfire;
+    //rapidfire presses per second, and the percentage of the time the key is
+    //held down
+    int rapidRate;
+    int rapidDuty;
+    bool sticky;
+    bool useMouse;
+    bool hasLayout;
+    int keycode;
+    //the keysym keycode was looked up for, 0 if the layout gave a keycode
+    uint32_t keysym;
+    //the number of the macro to play instead of the key, 0 for none
+    int macro;
+    //plays it, set up by the JoyPad when a layout is loaded
+    MacroPlayer *player;
+
+    //current state
+    //true iff this button is physically depressed.
+    bool isButtonPressed;
+    //is a simulated key currently depressed?
+    bool isDown;
+    //when rapidfire started and how many presses it has done since
+    int64_t rapidStart;
+    int rapidCycle;
+
+private:
+    //when the next rapidfire press or release is due
+    int64_t rapidDeadline(bool press) const;
+    //actually sends a key press/release
+    void click(bool press);
+};
+
+#endif
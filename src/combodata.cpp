@@ -0,0 +1,22 @@
+#include "combodata.h"
+#include "event.h"
+
+ComboData::ComboData() {
+    buttons = 0;
+    window = COMBO_WINDOW_MSEC;
+    useMouse = false;
+    keycode = 0;
+    keysym = 0;
+    hasLayout = false;
+    isDown = false;
+}
+
+void ComboData::click(bool press) {
+    if (isDown == press) return;
+    isDown = press;
+    FakeEvent click;
+    if (press) click.type = useMouse ? FakeEvent::MouseDown : FakeEvent::KeyDown;
+    else click.type = useMouse ? FakeEvent::MouseUp : FakeEvent::KeyUp;
+    click.keycode = keycode;
+    sendevent(click);
+}
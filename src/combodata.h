@@ -0,0 +1,34 @@
+#ifndef QJOYPAD_COMBODATA_H
+#define QJOYPAD_COMBODATA_H
+
+#include <QString>
+
+#include "constant.h"
+
+//a set of buttons that does something when they are all pressed together.
+//A JoyPad keeps these in a table and looks them up by the set of buttons
+//that is currently pressed.
+struct ComboData {
+    ComboData();
+
+    //press or release the key or mouse button of this combo
+    void click(bool press);
+
+    //settings
+    //one bit per button, bit n is Button n+1
+    quint64 buttons;
+    //all buttons have to be pressed within this many milliseconds
+    int window;
+    bool useMouse;
+    int keycode;
+    //the keysym keycode was looked up for, 0 if the layout gave a keycode
+    quint32 keysym;
+    bool hasLayout;
+    QString layout;
+
+    //current state
+    //is a simulated key currently depressed?
+    bool isDown;
+};
+
+#endif
@@ -16,6 +16,9 @@
 #define JOYMAX 32767
 #define JOYMIN -32767
 
+//the most axes or buttons a device can have. js_event.number is 8 bits.
+#define MAXCONTROLS 256
+
 //maximum number of defined keys
 #define MAXKEY 255
 
@@ -25,4 +28,59 @@
 #define SENSITIVITY_MIN	1e-8F
 #define SENSITIVITY_MAX	1e+8F
 
+//how long a burst of device hotplug events has to be quiet before the tray
+//menu and the layout editor get rebuilt.
+#define HOTPLUG_SETTLE_MSEC 250
+
+//how often the layout editor shows the current state of the controls. There is
+//no point in doing this faster than a display refreshes.
+#define GUI_REFRESH_MSEC 16
+
+//how many fake events can wait for the output thread. Must be a power of 2.
+#define OUTPUT_QUEUE_SIZE 4096
+//how many more wait on the GUI thread when that is full, before they are
+//dropped (see OutputThread::push())
+#define OUTPUT_OVERFLOW_SIZE 65536
+
+//how long "qjoypad --stats" waits for the running instance to answer.
+#define STATS_WAIT_MSEC 1000
+
+//default pwm of gradient keyboard axes: the length of a cycle, and how many
+//steps there are between not pressing the key and holding it all the time.
+#define PWM_PERIOD_MSEC (FREQ * MSEC)
+#define PWM_LEVELS FREQ
+#define PWM_MAXLEVELS 1000
+
+//default rapidfire presses per second and percentage of the time the key is
+//held down.
+#define RAPIDFIRE_RATE 20
+#define RAPIDFIRE_DUTY 50
+#define RAPIDFIRE_MAXRATE 500
+
+//how long the buttons of a combo may take to all be pressed, if the layout
+//doesn't say.
+#define COMBO_WINDOW_MSEC 200
+
+//combos can only be made of the first this many buttons of a device.
+#define MAXCOMBOBUTTON 64
+
+//how often an axis filter that hasn't caught up with its axis is stepped
+//again, and the most the cutoff and beta of a filter can be set to.
+#define FILTER_SETTLE_MSEC MSEC
+#define FILTER_MAXCUTOFF 1000.0F
+
+//how many events of a motion sensor are read at once, and the longest time
+//between two of its frames that is integrated (in microseconds). Longer gaps
+//mean frames were lost, and guessing what happened in them would only throw
+//the aim off.
+#define SENSOR_READ_EVENTS 256
+#define SENSOR_MAX_DT_USEC 50000
+//the most pixels per degree a gyro can move the mouse, and the highest dead
+//zone it can have, in degrees per second (the full range of common sensors)
+#define GYRO_MAXSENSITIVITY 100.0F
+#define GYRO_MAXRATE 2000.0F
+
+//absolute axes can put the mouse on one of this many monitors.
+#define MAXMONITORS 16
+
 #endif
@@ -2,12 +2,19 @@
 #define QJOYPAD_ERROR_H
 
 #include <qmessagebox.h>
+#include <QApplication>
+#include <stdio.h>
 #include <stdarg.h>
 #include "config.h"
 
 //a nice simple way of throwing up an error message if something goes wrong.
 
 inline void errorBox(const QString &title, const QString &message, QWidget *parent = 0) {
+    //the tools without a GUI, like qjoypad-replay, print it instead
+    if (!qobject_cast<QApplication*>(QCoreApplication::instance())) {
+        fprintf(stderr, "%s: %s\n", qPrintable(title), qPrintable(message));
+        return;
+    }
     QMessageBox::warning(parent, QString("%1 - %2").arg(title, QJOYPAD_NAME),
 		message, QMessageBox::Ok, Qt::NoButton);
 }
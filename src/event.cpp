@@ -1,48 +1,69 @@
 #include <QX11Info>
 #include "event.h"
+#include "output.h"
+#include "stats.h"
 
 //actually creates an XWindows event  :)
-void sendevent(const FakeEvent &e) {
-    Display* display = QX11Info::display();
-
+bool xtestevent(Display *display, const FakeEvent &e) {
     switch (e.type) {
     case FakeEvent::MouseMove:
-        if (e.move.x == 0 && e.move.y == 0) return;
+        if (e.move.x == 0 && e.move.y == 0) return false;
         XTestFakeRelativeMotionEvent(display, e.move.x, e.move.y, 0);
         break;
 
     case FakeEvent::MouseMoveAbsolute:
-      {
-        Screen* screen = XDefaultScreenOfDisplay(display);
-        static int rememberX = 0, rememberY = 0;
-        if (e.move.x) rememberX = e.move.x;
-        if (e.move.y) rememberY = e.move.y;
-        const int scaledX100 = rememberX * (XWidthOfScreen(screen)/2) / 100;
-        const int scaledY100 = rememberY * (XHeightOfScreen(screen)/2) / 100;
-        XTestFakeMotionEvent(display, DefaultScreen(display),
-                             XWidthOfScreen(screen)/2 + scaledX100,
-                             XHeightOfScreen(screen)/2 + scaledY100, 0);
+        XTestFakeMotionEvent(display, DefaultScreen(display), e.move.x, e.move.y, 0);
         break;
-      }
+
     case FakeEvent::KeyUp:
-        if (e.keycode == 0) return;
+        if (e.keycode == 0) return false;
         XTestFakeKeyEvent(display, e.keycode, false, 0);
         break;
 
     case FakeEvent::KeyDown:
-        if (e.keycode == 0) return;
+        if (e.keycode == 0) return false;
         XTestFakeKeyEvent(display, e.keycode, true, 0);
         break;
 
     case FakeEvent::MouseUp:
-        if (e.keycode == 0) return;
+        if (e.keycode == 0) return false;
         XTestFakeButtonEvent(display, e.keycode, false, 0);
         break;
 
     case FakeEvent::MouseDown:
-        if (e.keycode == 0) return;
+        if (e.keycode == 0) return false;
         XTestFakeButtonEvent(display, e.keycode, true, 0);
         break;
     }
-    XFlush(display);
+    statAdd(Stats::instance().outputEvents[e.type]);
+    return true;
+}
+
+static EventSink *eventSink = 0;
+
+void setEventSink(EventSink *sink) {
+    eventSink = sink;
+}
+
+void sendevent(const FakeEvent &e) {
+    if (DeviceStats::current) DeviceStats::current->addOutput(e.type);
+    if (eventSink) {
+        eventSink->event(e);
+        return;
+    }
+    OutputThread *output = OutputThread::instance();
+    if (output) {
+        output->push(e);
+        return;
+    }
+    Display* display = QX11Info::display();
+    if (xtestevent(display, e)) {
+        XFlush(display);
+        statAdd(Stats::instance().flushes);
+    }
+}
+
+void flushevents() {
+    OutputThread *output = OutputThread::instance();
+    if (output) output->flush();
 }
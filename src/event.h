@@ -14,6 +14,7 @@ struct FakeEvent {
     union {
         int keycode;
 
+        //relative for MouseMove, a pixel on the screen for MouseMoveAbsolute
         struct {
             int x;
             int y;
@@ -21,6 +22,22 @@ struct FakeEvent {
     };
 };
 
+//takes the events instead of the X server, for the replay tool
+class EventSink {
+    public:
+        virtual ~EventSink() {}
+        virtual void event(const FakeEvent &e) = 0;
+};
+
+//send e. With an output thread running, it's queued and goes out with the
+//next flushevents(), or when the GUI thread is back in its event loop.
 void sendevent(const FakeEvent& e);
+//send everything to sink from now on, or to X again if it's 0
+void setEventSink(EventSink *sink);
+//hand everything sent so far to the output thread as one batch
+void flushevents();
+//send e on display, without flushing. Returns false if there was nothing
+//to send.
+bool xtestevent(Display *display, const FakeEvent& e);
 
 #endif
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+
+#include "filter.h"
+#include "constant.h"
+
+//1e6 / 2pi: alpha = dt / (dt + tau) with tau = 1 / (2pi fc) becomes
+//dt * fc / (dt * fc + FILTER_TAU) for dt in ms and fc in mHz
+#define FILTER_TAU 159155
+//the cutoff for the speed itself, in mHz
+#define FILTER_SPEED_CUTOFF 1000
+//how close the output has to get to a value that doesn't change any more
+//before it jumps there, in axis units
+#define FILTER_SNAP 64
+//longer gaps between events count as this many ms, which is plenty to catch
+//up at any cutoff and keeps the fixed point from overflowing
+#define FILTER_MAX_DT 10000
+
+//the smoothing factor for dt and cutoff, in 1/65536
+static inline int64_t alpha(int64_t dt, int64_t cutoff) {
+    const int64_t x = dt * cutoff;
+    return (x << 16) / (x + FILTER_TAU);
+}
+
+AxisFilter::AxisFilter()
+    : minCutoff(0), beta(0) {
+    reset();
+}
+
+void AxisFilter::configure(float cutoff, float beta) {
+    minCutoff = (cutoff > 0.0F) ? int64_t(cutoff * 1000.0F + 0.5F) : 0;
+    this->beta = (beta > 0.0F) ? int64_t(beta * 1000.0F + 0.5F) : 0;
+    reset();
+}
+
+void AxisFilter::reset() {
+    primed = false;
+    value = 0;
+    filtered = 0;
+    speed = 0;
+    time = 0;
+}
+
+int AxisFilter::step(int value, uint32_t time) {
+    this->value = value;
+    if (!primed || minCutoff == 0) {
+        primed = true;
+        filtered = value * 256;
+        speed = 0;
+        this->time = time;
+        return value;
+    }
+    //events read together can have the same time
+    int64_t dt = int32_t(time - this->time);
+    if (dt < 1) dt = 1;
+    if (dt > FILTER_MAX_DT) dt = FILTER_MAX_DT;
+    this->time = time;
+
+    //how fast the axis moves, smoothed with a fixed cutoff
+    const int64_t delta = int64_t(value) * 256 - filtered;
+    const int64_t rawSpeed = delta * 1000 / (dt * 256);
+    speed += ((rawSpeed - speed) * alpha(dt, FILTER_SPEED_CUTOFF)) >> 16;
+
+    //the faster it moves, the less it is smoothed
+    const int64_t cutoff = minCutoff + beta * llabs(speed) / JOYMAX;
+    filtered += int32_t((delta * alpha(dt, cutoff)) >> 16);
+    return output();
+}
+
+bool AxisFilter::settle(uint32_t interval) {
+    step(value, time + interval);
+    //close enough not to matter, and it would take long to get any closer
+    if (abs(output() - value) <= FILTER_SNAP) {
+        filtered = value * 256;
+        speed = 0;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,46 @@
+#ifndef QJOYPAD_FILTER_H
+#define QJOYPAD_FILTER_H
+
+#include <stdint.h>
+
+//A One-Euro filter (Casiez et al.) for the values of one axis: a low-pass
+//filter whose cutoff goes up with the speed of the axis. Resting sticks
+//are smoothed hard, which takes the jitter out of worn ones, while fast
+//moves come through with little lag. Everything is done in fixed point.
+//
+//Events only come when the axis moves, so a filter that isn't settled yet
+//has to be stepped again with the last value until it is (see settle()).
+class AxisFilter {
+    public:
+        AxisFilter();
+        //cutoff is the cutoff frequency of a resting axis in Hz, 0 turns
+        //the filter off. beta is how many Hz it goes up by for every full
+        //swing of the axis per second.
+        void configure(float cutoff, float beta);
+        bool isOn() const { return minCutoff > 0; }
+        //forget the past, the next value goes through as it is
+        void reset();
+        //filter value, read at time (in milliseconds)
+        int step(int value, uint32_t time);
+        //step again with the last value, interval milliseconds after the last
+        //step. Returns true once the output has caught up with the value.
+        bool settle(uint32_t interval);
+        int output() const { return (filtered + 128) >> 8; }
+        //true iff the output is the last value
+        bool isSettled() const { return output() == value; }
+
+    private:
+        //settings, in mHz and mHz per full swing per second
+        int64_t minCutoff;
+        int64_t beta;
+
+        //state. filtered is in 1/256 of axis units, speed in axis units per
+        //second.
+        bool primed;
+        int value;
+        int32_t filtered;
+        int64_t speed;
+        uint32_t time;
+};
+
+#endif
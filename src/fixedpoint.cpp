@@ -0,0 +1,79 @@
+#include "fixedpoint.h"
+
+//2^(-2^-k) for k = 1..16, in 1/2^30
+static const int64_t exp2Table[16] = {
+    759250125, 902905651, 984625594, 1028218693, 1050733751, 1062175491,
+    1067942999, 1070838486, 1072289173, 1073015252, 1073378477, 1073560135,
+    1073650976, 1073696399, 1073719111, 1073730468
+};
+
+//the largest exponent that still makes a difference: u^(2^20) is 0 for
+//every u below FIX_ONE
+#define FIX_MAX_EXPONENT (int64_t(1) << 36)
+
+int64_t fixExponent(float sensitivity) {
+    if (!(sensitivity > 0.0F)) return FIX_MAX_EXPONENT;
+    const double exponent = 65536.0 / sensitivity;
+    return (exponent >= double(FIX_MAX_EXPONENT)) ? FIX_MAX_EXPONENT : int64_t(exponent + 0.5);
+}
+
+//log2 of value, in 1/65536. Bit by bit, by squaring the mantissa.
+static int64_t log2Fix(uint32_t value) {
+    int msb = 31;
+    while (!(value & (1U << msb))) --msb;
+    int64_t result = int64_t(msb) << 16;
+    //the mantissa, from 1 to 2 in 1/2^30
+    uint64_t m = (msb <= 30) ? uint64_t(value) << (30 - msb) : uint64_t(value) >> 1;
+    for (int bit = 1 << 15; bit > 0; bit >>= 1) {
+        m = (m * m) >> 30;
+        if (m >= (uint64_t(2) << 30)) {
+            m >>= 1;
+            result += bit;
+        }
+    }
+    return result;
+}
+
+int32_t fixPow(int32_t u, int64_t exponent) {
+    if (u <= 0) return 0;
+    if (u >= FIX_ONE || exponent <= 0) return FIX_ONE;
+    //log2 of u as a fraction, below 0
+    const int64_t l = log2Fix(uint32_t(u)) - (int64_t(FIX_SHIFT) << 16);
+    const int64_t p = -((l * exponent) >> 16);
+    if (p >= (int64_t(FIX_SHIFT + 1) << 16)) return 0;
+
+    //2^-p: the whole part is a shift, the fraction a product of the table
+    int64_t r = int64_t(1) << 30;
+    const int frac = int(p & 0xffff);
+    for (int k = 0; k < 16; ++k) {
+        if (frac & (0x8000 >> k)) r = (r * exp2Table[k]) >> 30;
+    }
+    return int32_t(r >> (30 - FIX_SHIFT + int(p >> 16)));
+}
+
+uint32_t isqrt(uint32_t value) {
+    uint32_t result = 0;
+    uint32_t bit = 1U << 30;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+void AxisCalibration::setRange(int min, int max) {
+    if (max <= min) {
+        *this = AxisCalibration();
+        return;
+    }
+    center = min + (max - min) / 2;
+    negGain = (center > min) ? int32_t((int64_t(JOYMAX) << 16) / (center - min)) : 65536;
+    posGain = (max > center) ? int32_t((int64_t(JOYMAX) << 16) / (max - center)) : 65536;
+}
@@ -0,0 +1,75 @@
+#ifndef QJOYPAD_FIXEDPOINT_H
+#define QJOYPAD_FIXEDPOINT_H
+
+#include <stdint.h>
+
+#include "constant.h"
+
+//The axis pipeline is done in integers from the device value to the pixels
+//sent, so it gives the same result with every compiler, optimization level
+//and CPU. Positions along a curve (u) and its values (f) are fractions in
+//1/FIX_ONE, mouse speeds are in 1/8 pixel per tick, and the sub-pixel
+//movement carried over between ticks is in 1/2^REST_SHIFT pixel.
+//
+//Every product below stays under 2^31: u and f are at most FIX_ONE (f times
+//1.5 past the knee of QuadraticExtreme), speeds at most MAXMOUSESPEED * 8.
+#define FIX_SHIFT 15
+#define FIX_ONE (1 << FIX_SHIFT)
+//0.95 and 1.5, for QuadraticExtreme
+#define FIX_KNEE 31130
+#define FIX_EXTREME 49152
+#define SPEED_SHIFT 3
+#define REST_SHIFT (FIX_SHIFT + SPEED_SHIFT)
+#define REST_MASK ((1 << REST_SHIFT) - 1)
+
+//the scale that maps [low, high] to [0, FIX_ONE] in fixUnit()
+static inline int32_t fixScale(int low, int high) {
+    const int range = (high > low) ? high - low : 1;
+    return (1 << 30) / range;
+}
+
+//how far value is between low and high, from 0 to FIX_ONE
+static inline int32_t fixUnit(int value, int low, int high, int32_t scale) {
+    const int32_t range = (high > low) ? high - low : 0;
+    int32_t d = value - low;
+    if (d < 0) d = 0;
+    if (d > range) d = range;
+    return (d * scale) >> FIX_SHIFT;
+}
+
+//whole pixels in rest, rounded towards 0 like a cast of a float would
+static inline int32_t restPixels(int32_t rest) {
+    return (rest + ((rest >> 31) & REST_MASK)) >> REST_SHIFT;
+}
+
+//the exponent of PowerFunction for a sensitivity, in 1/65536
+int64_t fixExponent(float sensitivity);
+//u to the power of exponent (as given by fixExponent()), both fractions in
+//1/FIX_ONE and 1/65536. Done with integer log2 and exp2, no libm involved.
+int32_t fixPow(int32_t u, int64_t exponent);
+//the integer square root, rounded down
+uint32_t isqrt(uint32_t value);
+
+//the calibration of one axis of a device: maps what the driver reports to
+//JOYMIN..JOYMAX, with center at 0. The joystick driver already does this
+//unless its correction was turned off (jscal -u, or JS_CORR_NONE), in which
+//case the values are raw device units and the range is taken from evdev.
+struct AxisCalibration {
+    AxisCalibration() : center(0), negGain(65536), posGain(65536) {}
+    //the range the device reports for the axis
+    void setRange(int min, int max);
+    bool isIdentity() const { return center == 0 && negGain == 65536 && posGain == 65536; }
+    int apply(int value) const {
+        if (isIdentity()) return value;
+        const int64_t d = int64_t(value) - center;
+        const int64_t v = (d * (d < 0 ? negGain : posGain)) >> 16;
+        return (v < JOYMIN) ? JOYMIN : (v > JOYMAX) ? JOYMAX : int(v);
+    }
+
+    int center;
+    //the gain below and above center, in 1/65536
+    int32_t negGain;
+    int32_t posGain;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include <math.h>
+
+#include "gyrodata.h"
+#include "motion.h"
+
+GyroData::GyroData() {
+    toDefault();
+}
+
+void GyroData::toDefault() {
+    //pitch and yaw of the DualShock 4 and DualSense (hid-playstation)
+    xAxis = 1;
+    yAxis = 0;
+    sensitivity = 0.0F;
+    dZone = 0.0F;
+    reverseX = false;
+    reverseY = false;
+    release();
+}
+
+bool GyroData::isDefault() const {
+    return (xAxis == 1) &&
+           (yAxis == 0) &&
+           (sensitivity == 0.0F) &&
+           (dZone == 0.0F) &&
+           (reverseX == false) &&
+           (reverseY == false);
+}
+
+void GyroData::frame(const float rate[3], float dt) {
+    float rx = rate[xAxis];
+    float ry = rate[yAxis];
+    if (fabsf(rx) < dZone) rx = 0.0F;
+    if (fabsf(ry) < dZone) ry = 0.0F;
+    const float scale = dt * sensitivity;
+    x += (reverseX ? -rx : rx) * scale;
+    y += (reverseY ? -ry : ry) * scale;
+}
+
+void GyroData::flush() {
+    if (x == 0.0F && y == 0.0F) return;
+    MotionBatch::instance().add(x, y);
+    x = 0.0F;
+    y = 0.0F;
+}
+
+void GyroData::release() {
+    x = 0.0F;
+    y = 0.0F;
+}
@@ -0,0 +1,42 @@
+#ifndef QJOYPAD_GYRODATA_H
+#define QJOYPAD_GYRODATA_H
+
+#include <stdint.h>
+
+//Aiming by turning the pad: the angular velocity from the motion sensors of
+//a device is integrated into mouse movement. The sensors report up to a
+//thousand frames a second. Those are only added up here, and handed to the
+//MotionBatch (motion.h) once for everything read in one go. The batch sends
+//them with the movement of the sticks, once per tick.
+struct GyroData {
+    GyroData();
+
+    //one frame of the sensors: the angular velocity around ABS_RX, ABS_RY
+    //and ABS_RZ in degrees per second, and the seconds since the last frame
+    void frame(const float rate[3], float dt);
+    //hand the movement added up since the last flush() to the MotionBatch
+    void flush();
+    //drop whatever was added up and not flushed yet
+    void release();
+    void toDefault();
+    bool isDefault() const;
+    //true iff the sensors are used at all
+    bool isOn() const { return sensitivity > 0.0F; }
+
+    //settings. xAxis and yAxis say which rotation moves the mouse
+    //horizontally and vertically: 0 for ABS_RX, 1 for ABS_RY, 2 for ABS_RZ.
+    //sensitivity is in pixels per degree, 0 turns the gyro off. Rates below
+    //dZone degrees per second are taken for sensor noise and ignored.
+    int xAxis;
+    int yAxis;
+    float sensitivity;
+    float dZone;
+    bool reverseX;
+    bool reverseY;
+
+    //current state: the movement since the last flush, in pixels
+    float x;
+    float y;
+};
+
+#endif
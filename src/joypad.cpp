@@ -1,4 +1,5 @@
 #include <QApplication>
+#include <QDir>
 
 #include "joypad.h"
 
@@ -13,10 +14,22 @@
 #include <stdint.h>
 
 JoyPad::JoyPad( int i, int dev, QObject *parent )
-    : QObject(parent), joydev(-1), axisCount(0), buttonCount(0), jpw(0), readNotifier(0), errorNotifier(0) {
+    : QObject(parent), joydev(-1), axisCount(0), buttonCount(0),
+      pressedButtons(0), pressTime(MAXCOMBOBUTTON, 0), activeCombo(-1),
+      stats(&Stats::instance().input), stickEvents(0), synced(false), sensor(0), jpw(0), readNotifier(0), errorNotifier(0) {
     debug_mesg("Constructing the joypad device with index %d and fd %d\n", i, dev);
     //remember the index,
     index = i;
+    //buttons and axes are scheduled by their address, so the tables are made
+    //big enough for every js_event.number right away and never move.
+    axisData.reserve(MAXCONTROLS);
+    buttonData.reserve(MAXCONTROLS);
+    //room for the state of every axis and button
+    resyncEvents.reserve(MAXCONTROLS * 2);
+    for (int m = 0; m <= MAXMONITORS; ++ m) {
+        pointers[m].monitor = m;
+    }
+    sensor = new MotionSensor(&gyro, this);
 
     //load data from the joystick device, if available.
     if (dev >= 0) {
@@ -30,10 +43,18 @@ JoyPad::JoyPad( int i, int dev, QObject *parent )
 }
 
 JoyPad::~JoyPad() {
+    //the axes and buttons are views on our tables, so they have to go first.
+    release();
+    clearMacros();
+    qDeleteAll(axes);
+    axes.clear();
+    qDeleteAll(buttons);
+    buttons.clear();
     close();
 }
 
 void JoyPad::close() {
+    sensor->close();
     if (readNotifier) {
         disconnect(readNotifier, 0, 0, 0);
 
@@ -65,6 +86,9 @@ void JoyPad::open(int dev) {
     //remember the device file descriptor
     close();
     joydev = dev;
+    //the first events are the state of every control, nothing was lost yet
+    synced = false;
+    resyncEvents.clear();
 
     char id[256];
     memset(id, 0, sizeof(id));
@@ -86,12 +110,9 @@ void JoyPad::open(int dev) {
     //have a real joystick axis mapped to it, and this function suddenly brings
     //that axis into use, the key assignment will not be lost because the axis
     //will already exist and no new axis will be created.
-    for (int i = axes.size(); i < axisCount; i++) {
-        axes.append(new Axis( i, this ));
-    }
-    for (int i = buttons.size(); i < buttonCount; i++) {
-        buttons.append(new Button( i, this ));
-    }
+    growAxes(axisCount);
+    growButtons(buttonCount);
+    readCalibration();
     debug_mesg("Setting up joyDeviceListeners\n");
     readNotifier = new QSocketNotifier(joydev, QSocketNotifier::Read, this);
     connect(readNotifier, SIGNAL(activated(int)), this, SLOT(handleJoyEvents()));
@@ -113,23 +134,95 @@ int JoyPad::getIndex() const {
     return index;
 }
 
+void JoyPad::readCalibration() {
+    calibration.fill(AxisCalibration(), axisCount);
+    js_corr corr[ABS_CNT];
+    quint8 axmap[ABS_CNT];
+    if (axisCount <= 0 || axisCount > ABS_CNT ||
+        ioctl(joydev, JSIOCGCORR, corr) < 0 ||
+        ioctl(joydev, JSIOCGAXMAP, axmap) < 0) {
+        return;
+    }
+    //the driver only passes raw values on if its correction was turned off,
+    //the range of those is in the absinfo of the event device
+    int evdev = -1;
+    for (int i = 0; i < axisCount; ++ i) {
+        if (corr[i].type != JS_CORR_NONE) continue;
+        if (evdev < 0) {
+            QDir dir(QString("/sys/class/input/js%1/device").arg(index));
+            const QStringList events = dir.entryList(QStringList("event*"), QDir::Dirs);
+            if (events.isEmpty()) return;
+            evdev = ::open(qPrintable("/dev/input/" + events.first()), O_RDONLY | O_NONBLOCK);
+            if (evdev < 0) return;
+        }
+        input_absinfo info;
+        if (ioctl(evdev, EVIOCGABS(axmap[i]), &info) >= 0) {
+            calibration[i].setRange(info.minimum, info.maximum);
+            debug_mesg("js%d axis %d is uncalibrated, range %d..%d\n",
+                       index, i, info.minimum, info.maximum);
+        }
+    }
+    if (evdev >= 0) ::close(evdev);
+}
+
+void JoyPad::growAxes(int count) {
+    for (int i = axisData.size(); i < count; ++ i) {
+        axisData.resize(i + 1);
+        axisData[i].pointers = pointers;
+        axisData[i].setOutputStats(&stats);
+    }
+    while (axisStick.size() < count) {
+        axisStick.append(-1);
+    }
+    for (int i = axes.size(); i < count; ++ i) {
+        axes.append(new Axis( i, &axisData, this ));
+    }
+}
+
+void JoyPad::growButtons(int count) {
+    for (int i = buttonData.size(); i < count; ++ i) {
+        buttonData.resize(i + 1);
+        buttonData[i].setOutputStats(&stats);
+    }
+    for (int i = buttons.size(); i < count; ++ i) {
+        buttons.append(new Button( i, &buttonData, this ));
+    }
+}
+
 void JoyPad::toDefault() {
     //to reset the whole, reset all the parts.
-    foreach (Axis *axis, axes) {
-        axis->toDefault();
+    clearMacros();
+    macros.clear();
+    for (int i = 0; i < sticks.size(); ++ i) {
+        sticks[i].release();
+    }
+    sticks.clear();
+    bindSticks();
+    if (activeCombo >= 0) {
+        combos[activeCombo].click(false);
+        activeCombo = -1;
+    }
+    combos.clear();
+    compileCombos();
+    for (int i = 0; i < axisData.size(); ++ i) {
+        axisData[i].toDefault();
     }
-    foreach (Button *button, buttons) {
-        button->toDefault();
+    for (int i = 0; i < buttonData.size(); ++ i) {
+        buttonData[i].toDefault();
     }
+    gyro.toDefault();
+    updateSensor();
 }
 
 bool JoyPad::isDefault() {
     //if any of the parts are not at default, then the whole isn't either.
-    foreach (Axis *axis, axes) {
-        if (!axis->isDefault()) return false;
+    if (!sticks.isEmpty() || !combos.isEmpty() || !macros.isEmpty()) return false;
+    if (!gyro.isDefault()) return false;
+    for (int i = 0; i < axisData.size(); ++ i) {
+        if (!axisData[i].isDefault()) return false;
     }
-    foreach (Button *button, buttons) {
-        if (!button->isDefault()) return false;
+    for (int i = 0; i < buttonData.size(); ++ i) {
+        if (!buttonData[i].isDefault()) return false;
     }
     return true;
 }
@@ -146,15 +239,17 @@ bool JoyPad::readConfig( QTextStream &stream ) {
         word = word.toLower();
         if (word == "button") {
             stream >> num;
+            if (num > MAXCONTROLS) {
+                errorBox(tr("Layout file error"), tr("Button %1 is out of range.").arg(num));
+                return false;
+            }
             if (num > 0) {
                 stream >> ch;
                 if (ch != ':') {
                     errorBox(tr("Layout file error"), tr("Expected ':', found '%1'.").arg(ch));
                     return false;
                 }
-                for (int i = buttons.size(); i < num; ++ i) {
-                    buttons.append(new Button(i, this));
-                }
+                growButtons(num);
                 if (!buttons[num-1]->read( stream )) {
                     errorBox(tr("Layout file error"), tr("Error reading Button %1").arg(num));
                     return false;
@@ -164,7 +259,41 @@ bool JoyPad::readConfig( QTextStream &stream ) {
                 stream.readLine();
             }
         }
-        else if (word == "axis") {
+        else if (word == "stick") {
+            stream >> num;
+            if (num > 0) {
+                stream >> ch;
+                if (ch != ':') {
+                    errorBox(tr("Layout file error"), tr("Expected ':', found '%1'.").arg(ch));
+                    return false;
+                }
+                if (!readStick(stream, num)) {
+                    errorBox(tr("Layout file error"), tr("Error reading Stick %1").arg(num));
+                    return false;
+                }
+            }
+            else {
+                stream.readLine();
+            }
+        }
+        else if (word == "macro") {
+            stream >> num;
+            if (num > 0) {
+                stream >> ch;
+                if (ch != ':') {
+                    errorBox(tr("Layout file error"), tr("Expected ':', found '%1'.").arg(ch));
+                    return false;
+                }
+                if (!readMacro(stream, num)) {
+                    errorBox(tr("Layout file error"), tr("Error reading Macro %1").arg(num));
+                    return false;
+                }
+            }
+            else {
+                stream.readLine();
+            }
+        }
+        else if (word == "combo") {
             stream >> num;
             if (num > 0) {
                 stream >> ch;
@@ -172,9 +301,34 @@ bool JoyPad::readConfig( QTextStream &stream ) {
                     errorBox(tr("Layout file error"), tr("Expected ':', found '%1'.").arg(ch));
                     return false;
                 }
-                for (int i = axes.size(); i < num; ++ i) {
-                    axes.append(new Axis(i, this));
+                if (!readCombo(stream, num)) {
+                    errorBox(tr("Layout file error"), tr("Error reading Combo %1").arg(num));
+                    return false;
                 }
+            }
+            else {
+                stream.readLine();
+            }
+        }
+        else if (word == "gyro:") {
+            if (!readGyro(stream)) {
+                errorBox(tr("Layout file error"), tr("Error reading Gyro"));
+                return false;
+            }
+        }
+        else if (word == "axis") {
+            stream >> num;
+            if (num > MAXCONTROLS) {
+                errorBox(tr("Layout file error"), tr("Axis %1 is out of range.").arg(num));
+                return false;
+            }
+            if (num > 0) {
+                stream >> ch;
+                if (ch != ':') {
+                    errorBox(tr("Layout file error"), tr("Expected ':', found '%1'.").arg(ch));
+                    return false;
+                }
+                growAxes(num);
                 if (!axes[num-1]->read(stream)) {
                     errorBox(tr("Layout file error"), tr("Error reading Axis %1").arg(num));
                     return false;
@@ -187,9 +341,459 @@ bool JoyPad::readConfig( QTextStream &stream ) {
         }
         stream >> word;
     }
+    bindSticks();
+    compileCombos();
+    compileMacros();
+    updateSensor();
+    return true;
+}
+
+bool JoyPad::readStick(QTextStream &stream, int num) {
+    QStringList words = stream.readLine().toLower().split(QRegExp("[\\s,]+"));
+    StickData stick;
+    bool ok;
+    int val;
+    float fval;
+
+    for (QStringList::Iterator it = words.begin(); it != words.end(); ++it) {
+        const QString word = *it;
+        if (word.isEmpty()) {
+            continue;
+        }
+        else if (word == "reversex") {
+            stick.reverseX = true;
+            continue;
+        }
+        else if (word == "reversey") {
+            stick.reverseY = true;
+            continue;
+        }
+        //everything else takes a value
+        ++it;
+        if (it == words.end()) return false;
+        if (word == "sens") {
+            fval = (*it).toFloat(&ok);
+            if (ok && fval >= SENSITIVITY_MIN && fval <= SENSITIVITY_MAX) stick.sensitivity = fval;
+            else return false;
+            continue;
+        }
+        val = (*it).toInt(&ok);
+        if (!ok) return false;
+        if (word == "xaxis" && val > 0 && val <= MAXCONTROLS) stick.xAxis = val - 1;
+        else if (word == "yaxis" && val > 0 && val <= MAXCONTROLS) stick.yAxis = val - 1;
+        else if (word == "dzone" && val >= 0 && val <= JOYMAX) stick.dZone = val;
+        else if (word == "xzone" && val >= 0 && val <= JOYMAX) stick.xZone = val;
+        else if (word == "maxspeed" && val >= 0 && val <= MAXMOUSESPEED) stick.maxSpeed = val;
+        else if (word == "tcurve" && val >= 0 && val <= StickData::PowerFunction) stick.transferCurve = (StickData::TransferCurve)val;
+        else return false;
+    }
+    if (stick.xAxis == stick.yAxis) return false;
+    stick.defined = true;
+    stick.configure();
+
+    growAxes(qMax(stick.xAxis, stick.yAxis) + 1);
+    while (sticks.size() < num) {
+        sticks.append(StickData());
+    }
+    sticks[num-1].release();
+    sticks[num-1] = stick;
     return true;
 }
 
+void JoyPad::writeStick(QTextStream &stream, int num) {
+    const StickData &stick = sticks[num];
+    if (!stick.defined) return;
+    stream << "Stick " << (num + 1) << ": "
+           << "xAxis " << (stick.xAxis + 1) << ", "
+           << "yAxis " << (stick.yAxis + 1) << ", "
+           << "dZone " << stick.dZone << ", "
+           << "xZone " << stick.xZone << ", "
+           << "maxSpeed " << stick.maxSpeed << ", "
+           << "tCurve " << stick.transferCurve << ", "
+           << "sens " << stick.sensitivity;
+    if (stick.reverseX) stream << ", reverseX";
+    if (stick.reverseY) stream << ", reverseY";
+    stream << "\n";
+}
+
+bool JoyPad::readGyro(QTextStream &stream) {
+    QStringList words = stream.readLine().toLower().split(QRegExp("[\\s,]+"));
+    GyroData settings;
+    bool ok;
+    int val;
+    float fval;
+
+    for (QStringList::Iterator it = words.begin(); it != words.end(); ++it) {
+        const QString word = *it;
+        if (word.isEmpty()) {
+            continue;
+        }
+        else if (word == "reversex") {
+            settings.reverseX = true;
+            continue;
+        }
+        else if (word == "reversey") {
+            settings.reverseY = true;
+            continue;
+        }
+        //everything else takes a value
+        ++it;
+        if (it == words.end()) return false;
+        if (word == "sens" || word == "dzone") {
+            fval = (*it).toFloat(&ok);
+            if (!ok) return false;
+            if (word == "sens" && fval >= 0.0F && fval <= GYRO_MAXSENSITIVITY) settings.sensitivity = fval;
+            else if (word == "dzone" && fval >= 0.0F && fval <= GYRO_MAXRATE) settings.dZone = fval;
+            else return false;
+            continue;
+        }
+        //the rotations around ABS_RX, ABS_RY and ABS_RZ are 1, 2 and 3
+        val = (*it).toInt(&ok);
+        if (!ok) return false;
+        if (word == "xaxis" && val > 0 && val <= 3) settings.xAxis = val - 1;
+        else if (word == "yaxis" && val > 0 && val <= 3) settings.yAxis = val - 1;
+        else return false;
+    }
+    gyro = settings;
+    return true;
+}
+
+void JoyPad::writeGyro(QTextStream &stream) {
+    stream << "Gyro: "
+           << "xAxis " << (gyro.xAxis + 1) << ", "
+           << "yAxis " << (gyro.yAxis + 1) << ", "
+           << "dZone " << gyro.dZone << ", "
+           << "sens " << gyro.sensitivity;
+    if (gyro.reverseX) stream << ", reverseX";
+    if (gyro.reverseY) stream << ", reverseY";
+    stream << "\n";
+}
+
+void JoyPad::openSensor(const QString &path) {
+    sensorPath = path;
+    updateSensor();
+}
+
+void JoyPad::updateSensor() {
+    if (!gyro.isOn() || sensorPath.isEmpty()) {
+        sensor->close();
+    }
+    else if (!sensor->isOpen()) {
+        sensor->open(sensorPath);
+    }
+}
+
+bool JoyPad::readCombo(QTextStream &stream, int num) {
+    QStringList words = stream.readLine().split(QRegExp("[\\s,]+"));
+    ComboData combo;
+    bool ok;
+    int val;
+
+    for (QStringList::Iterator it = words.begin(); it != words.end(); ++it) {
+        const QString word = (*it).toLower();
+        if (word.isEmpty()) {
+            continue;
+        }
+        else if (word == "buttons") {
+            //a list of button numbers, up to the next word
+            while (it + 1 != words.end()) {
+                val = (*(it + 1)).toInt(&ok);
+                if (!ok) break;
+                if (val <= 0 || val > MAXCOMBOBUTTON) return false;
+                combo.buttons |= Q_UINT64_C(1) << (val - 1);
+                ++it;
+            }
+            continue;
+        }
+        ++it;
+        if (it == words.end()) return false;
+        if (word == "layout") {
+            combo.layout = (*it).replace("\\s", " ");
+            combo.hasLayout = true;
+            continue;
+        }
+        if (word == "key") {
+            if (!readKey(*it, &combo.keycode, &combo.keysym)) return false;
+            combo.useMouse = false;
+            continue;
+        }
+        val = (*it).toInt(&ok);
+        if (!ok) return false;
+        if (word == "window" && val >= 0) combo.window = val;
+        else if (word == "mouse" && val >= 0 && val <= MAXKEY) {
+            combo.useMouse = true;
+            combo.keycode = val;
+            combo.keysym = 0;
+        }
+        else return false;
+    }
+    //a combo needs at least two buttons
+    if ((combo.buttons & (combo.buttons - 1)) == 0) return false;
+
+    while (combos.size() < num) {
+        combos.append(ComboData());
+    }
+    combos[num-1] = combo;
+    return true;
+}
+
+void JoyPad::writeCombo(QTextStream &stream, int num) {
+    const ComboData &combo = combos[num];
+    if (combo.buttons == 0) return;
+    stream << "Combo " << (num + 1) << ": buttons";
+    for (int i = 0; i < MAXCOMBOBUTTON; ++ i) {
+        if (combo.buttons & (Q_UINT64_C(1) << i)) stream << " " << (i + 1);
+    }
+    stream << ", window " << combo.window << ", ";
+    if (combo.useMouse) stream << "mouse " << combo.keycode;
+    else stream << "key " << keyString(combo.keycode, combo.keysym);
+    if (combo.hasLayout) stream << " layout " << QString(combo.layout).replace(" ", "\\s");
+    stream << "\n";
+}
+
+void JoyPad::compileCombos() {
+    comboLookup.clear();
+    for (int i = 0; i < combos.size(); ++ i) {
+        if (combos[i].buttons != 0) {
+            comboLookup.insert(combos[i].buttons, i);
+        }
+    }
+}
+
+bool JoyPad::comboEvent(int number, bool pressed, bool init, quint32 time) {
+    const quint64 bit = Q_UINT64_C(1) << number;
+    if (!pressed) {
+        pressedButtons &= ~bit;
+        if (activeCombo >= 0 && (combos[activeCombo].buttons & bit)) {
+            combos[activeCombo].click(false);
+            activeCombo = -1;
+        }
+        return false;
+    }
+    if (pressedButtons & bit) return false;
+    pressedButtons |= bit;
+    pressTime[number] = time;
+    //the state the device reports on open doesn't fire anything
+    if (init || comboLookup.isEmpty()) return false;
+
+    QHash<quint64, int>::const_iterator it = comboLookup.constFind(pressedButtons);
+    if (it == comboLookup.constEnd()) return false;
+    ComboData &combo = combos[it.value()];
+    //every button has to have been pressed within the window
+    for (quint64 rest = pressedButtons; rest != 0; rest &= rest - 1) {
+        if (time - pressTime[__builtin_ctzll(rest)] > quint32(combo.window)) return false;
+    }
+
+    if (combo.hasLayout) {
+        emit loadLayout(combo.layout);
+        return true;
+    }
+    if (activeCombo >= 0) {
+        combos[activeCombo].click(false);
+    }
+    activeCombo = it.value();
+    combo.click(true);
+    return false;
+}
+
+bool JoyPad::readMacro(QTextStream &stream, int num) {
+    QStringList words = stream.readLine().split(QRegExp("[\\s,]+"));
+    MacroData macro;
+    MacroStep step;
+    step.delay = 0;
+    step.keysym = 0;
+    int total = 0;
+    bool ok;
+    int val;
+
+    for (QStringList::Iterator it = words.begin(); it != words.end(); ++it) {
+        const QString word = (*it).toLower();
+        if (word.isEmpty()) {
+            continue;
+        }
+        else if (word == "cancel") {
+            macro.cancelOnRelease = true;
+            continue;
+        }
+        else if (word == "repeat") {
+            macro.repeat = true;
+            continue;
+        }
+        ++it;
+        if (it == words.end()) return false;
+        if (word == "press" || word == "release" || word == "key") {
+            if (!readKey(*it, &val, &step.keysym)) return false;
+        }
+        else {
+            val = (*it).toInt(&ok);
+            if (!ok) return false;
+            step.keysym = 0;
+        }
+
+        if (word == "wait") {
+            if (val < 0) return false;
+            //waits belong to the step before them
+            if (macro.steps.empty()) macro.delay += val;
+            else macro.steps.back().delay += val;
+            total += val;
+            continue;
+        }
+        else if (word == "move") {
+            ++it;
+            if (it == words.end()) return false;
+            step.event.type = FakeEvent::MouseMove;
+            step.event.move.x = val;
+            step.event.move.y = (*it).toInt(&ok);
+            if (!ok) return false;
+            macro.steps.push_back(step);
+            continue;
+        }
+
+        if (val < 0 || val > MAXKEY) return false;
+        step.event.keycode = val;
+        if (word == "press" || word == "key") step.event.type = FakeEvent::KeyDown;
+        else if (word == "release") step.event.type = FakeEvent::KeyUp;
+        else if (word == "mousepress" || word == "mouse") step.event.type = FakeEvent::MouseDown;
+        else if (word == "mouserelease") step.event.type = FakeEvent::MouseUp;
+        else return false;
+        macro.steps.push_back(step);
+
+        //key and mouse are a press and a release
+        if (word == "key" || word == "mouse") {
+            step.event.type = (word == "key") ? FakeEvent::KeyUp : FakeEvent::MouseUp;
+            macro.steps.push_back(step);
+        }
+    }
+    //a macro that repeats without ever waiting would never give control back
+    if (macro.repeat && total == 0) return false;
+
+    while (macros.size() < num) {
+        macros.append(MacroData());
+    }
+    macros[num-1] = macro;
+    return true;
+}
+
+void JoyPad::writeMacro(QTextStream &stream, int num) {
+    const MacroData &macro = macros[num];
+    stream << "Macro " << (num + 1) << ":";
+    QString separator = " ";
+    if (macro.cancelOnRelease) {
+        stream << separator << "cancel";
+        separator = ", ";
+    }
+    if (macro.repeat) {
+        stream << separator << "repeat";
+        separator = ", ";
+    }
+    if (macro.delay > 0) {
+        stream << separator << "wait " << macro.delay;
+        separator = ", ";
+    }
+    for (size_t i = 0; i < macro.steps.size(); ++ i) {
+        const FakeEvent &e = macro.steps[i].event;
+        stream << separator;
+        separator = ", ";
+        switch (e.type) {
+        case FakeEvent::KeyDown: stream << "press " << keyString(e.keycode, macro.steps[i].keysym); break;
+        case FakeEvent::KeyUp: stream << "release " << keyString(e.keycode, macro.steps[i].keysym); break;
+        case FakeEvent::MouseDown: stream << "mousePress " << e.keycode; break;
+        case FakeEvent::MouseUp: stream << "mouseRelease " << e.keycode; break;
+        default: stream << "move " << e.move.x << " " << e.move.y; break;
+        }
+        if (macro.steps[i].delay > 0) {
+            stream << ", wait " << macro.steps[i].delay;
+        }
+    }
+    stream << "\n";
+}
+
+void JoyPad::clearMacros() {
+    for (int i = 0; i < buttonData.size(); ++ i) {
+        buttonData[i].release();
+        buttonData[i].player = 0;
+    }
+    for (int i = 0; i < axisData.size(); ++ i) {
+        axisData[i].release();
+        axisData[i].pplayer = 0;
+        axisData[i].nplayer = 0;
+        axisData[i].downplayer = 0;
+    }
+    foreach (MacroPlayer *player, players) {
+        player->stop();
+    }
+    qDeleteAll(players);
+    players.clear();
+}
+
+void JoyPad::compileMacros() {
+    clearMacros();
+    for (int i = 0; i < buttonData.size(); ++ i) {
+        ButtonData &button = buttonData[i];
+        if (button.macro > 0 && button.macro <= macros.size()) {
+            button.player = new MacroPlayer(&macros[button.macro - 1]);
+            players.append(button.player);
+        }
+    }
+    for (int i = 0; i < axisData.size(); ++ i) {
+        AxisData &axis = axisData[i];
+        if (axis.pmacro > 0 && axis.pmacro <= macros.size()) {
+            axis.pplayer = new MacroPlayer(&macros[axis.pmacro - 1]);
+            players.append(axis.pplayer);
+        }
+        if (axis.nmacro > 0 && axis.nmacro <= macros.size()) {
+            axis.nplayer = new MacroPlayer(&macros[axis.nmacro - 1]);
+            players.append(axis.nplayer);
+        }
+    }
+    foreach (MacroPlayer *player, players) {
+        player->setOutputStats(&stats);
+    }
+}
+
+void JoyPad::bindSticks() {
+    for (int i = 0; i < axisStick.size(); ++ i) {
+        axisStick[i] = -1;
+    }
+    for (int i = 0; i < sticks.size(); ++ i) {
+        if (!sticks[i].defined) continue;
+        axisStick[sticks[i].xAxis] = i;
+        axisStick[sticks[i].yAxis] = i;
+    }
+}
+
+void JoyPad::resync() {
+    debug_mesg("events of joystick %d were lost, resyncing %d controls\n",
+               index + 1, resyncEvents.size());
+    //a missed release lets go of what the button or combo holds. A missed
+    //press is only noted, so the release that follows works as usual.
+    foreach (const js_event &msg, resyncEvents) {
+        if ((msg.type & ~JS_EVENT_INIT) == JS_EVENT_BUTTON) {
+            if (msg.number < MAXCOMBOBUTTON) {
+                comboEvent(msg.number, msg.value != 0, true, msg.time);
+            }
+            if (msg.number < buttonData.size()) {
+                buttonData[msg.number].resync(msg.value != 0);
+            }
+        }
+        else {
+            //axes only care about where they are now
+            jsevent(msg);
+        }
+    }
+    resyncEvents.clear();
+    stats.addResync();
+}
+
+int JoyPad::updateSticks() {
+    int moved = 0;
+    for (int i = 0; i < sticks.size(); ++ i) {
+        if (sticks[i].changed) ++ moved;
+        sticks[i].update();
+    }
+    return moved;
+}
+
 //only actually writes something if this JoyPad is NON DEFAULT.
 void JoyPad::write( QTextStream &stream ) {
     if (!axes.empty() || !buttons.empty()) {
@@ -199,6 +803,18 @@ void JoyPad::write( QTextStream &stream ) {
                 axis->write(stream);
             }
         }
+        for (int i = 0; i < sticks.size(); ++ i) {
+            writeStick(stream, i);
+        }
+        for (int i = 0; i < combos.size(); ++ i) {
+            writeCombo(stream, i);
+        }
+        for (int i = 0; i < macros.size(); ++ i) {
+            writeMacro(stream, i);
+        }
+        if (!gyro.isDefault()) {
+            writeGyro(stream);
+        }
         foreach (Button *button, buttons) {
             if (!button->isDefault()) {
                 button->write(stream);
@@ -209,15 +825,80 @@ void JoyPad::write( QTextStream &stream ) {
 }
 
 void JoyPad::release() {
-    foreach (Axis *axis, axes) {
-        axis->release();
+    OutputScope scope(&stats);
+    if (activeCombo >= 0) {
+        combos[activeCombo].click(false);
+        activeCombo = -1;
     }
-    foreach (Button *button, buttons) {
-        button->release();
+    for (int i = 0; i < sticks.size(); ++ i) {
+        sticks[i].release();
     }
+    for (int i = 0; i < axisData.size(); ++ i) {
+        axisData[i].release();
+    }
+    for (int i = 0; i < buttonData.size(); ++ i) {
+        buttonData[i].release();
+    }
+    for (int m = 0; m <= MAXMONITORS; ++ m) {
+        pointers[m].reset();
+    }
+    gyro.release();
 }
 
-void JoyPad::jsevent(const js_event &msg) {
+//look up the keycode of a key that was given as keysym. Only checks if it
+//moved unless update is set.
+static bool resolveKey(int &keycode, quint32 keysym, bool update) {
+    if (keysym == 0) return false;
+    const int current = keysymToKeycode(keysym);
+    if (current == keycode) return false;
+    if (update) keycode = current;
+    return true;
+}
+
+bool JoyPad::resolveKeys(bool update) {
+    bool moved = false;
+    for (int i = 0; i < buttonData.size(); ++ i) {
+        ButtonData &button = buttonData[i];
+        if (!button.useMouse) moved |= resolveKey(button.keycode, button.keysym, update);
+    }
+    for (int i = 0; i < axisData.size(); ++ i) {
+        AxisData &axis = axisData[i];
+        if (!axis.puseMouse) moved |= resolveKey(axis.pkeycode, axis.pkeysym, update);
+        if (!axis.nuseMouse) moved |= resolveKey(axis.nkeycode, axis.nkeysym, update);
+    }
+    for (int i = 0; i < combos.size(); ++ i) {
+        ComboData &combo = combos[i];
+        if (!combo.useMouse) moved |= resolveKey(combo.keycode, combo.keysym, update);
+    }
+    //the players point into macros, so the steps are changed in place
+    for (int i = 0; i < macros.size(); ++ i) {
+        std::vector<MacroStep> &steps = macros[i].steps;
+        for (size_t j = 0; j < steps.size(); ++ j) {
+            if (steps[j].event.type == FakeEvent::KeyDown || steps[j].event.type == FakeEvent::KeyUp) {
+                moved |= resolveKey(steps[j].event.keycode, steps[j].keysym, update);
+            }
+        }
+    }
+    return moved;
+}
+
+void JoyPad::resolveKeys() {
+    if (!resolveKeys(false)) return;
+    debug_mesg("keyboard mapping changed, looking up the keys of joypad %d again\n", index + 1);
+    //whatever is held down has to be let go of with the key it was pressed with
+    release();
+    foreach (MacroPlayer *player, players) {
+        player->stop();
+    }
+    resolveKeys(true);
+}
+
+void JoyPad::jsevent(const js_event &event) {
+    //everything after this sees calibrated axes
+    js_event msg = event;
+    if ((msg.type & ~JS_EVENT_INIT) == JS_EVENT_AXIS && msg.number < calibration.size()) {
+        msg.value = calibration[msg.number].apply(msg.value);
+    }
     //if there is a JoyPadWidget around, ie, if the joypad is being edited
     if (jpw != NULL && hasFocus) {
         //tell the dialog there was an event. It will use this to flash
@@ -235,13 +916,31 @@ void JoyPad::jsevent(const js_event &msg) {
     if (type == JS_EVENT_AXIS) {
         debug_mesg("DEBUG: passing on an axis event\n");
         debug_mesg("DEBUG: %d %d\n", msg.number, msg.value);
-        if (msg.number < axes.size()) axes[msg.number]->jsevent(msg.value);
+        if (msg.number < axisStick.size() && axisStick[msg.number] >= 0) {
+            //moved once all events that are waiting have been read
+            sticks[axisStick[msg.number]].jsevent(msg.number, msg.value);
+            ++ stickEvents;
+        }
+        else if (msg.number < axisData.size()) {
+            AxisData &axis = axisData[msg.number];
+            axis.jsevent(msg.value, msg.time);
+        }
         else debug_mesg("DEBUG: axis index out of range: %d\n", msg.value);
     }
     else if (type == JS_EVENT_BUTTON) {
         debug_mesg("DEBUG: passing on a button event\n");
         debug_mesg("DEBUG: %d %d\n", msg.number, msg.value);
-        if (msg.number < buttons.size()) buttons[msg.number]->jsevent(msg.value);
+        if (msg.number < MAXCOMBOBUTTON &&
+            comboEvent(msg.number, msg.value != 0, msg.type & JS_EVENT_INIT, msg.time)) {
+            //a layout is being loaded, the tables have changed
+            return;
+        }
+        if (msg.number < buttonData.size()) {
+            ButtonData &button = buttonData[msg.number];
+            if (button.jsevent(msg.value)) {
+                buttons[msg.number]->triggerLayout();
+            }
+        }
         else debug_mesg("DEBUG: button index out of range: %d\n", msg.value);
     }
 }
@@ -253,13 +952,59 @@ JoyPadWidget* JoyPad::widget( QWidget* parent, int i) {
 }
 
 void JoyPad::handleJoyEvents() {
-    js_event msg;
-    ssize_t len = read(joydev, &msg, sizeof(js_event));
-    //if there was a real event waiting,
-    if (len == sizeof(js_event)) {
+    //read everything that is waiting, so the sticks see both of their axes
+    //before they move.
+    js_event msg[32];
+    ssize_t len;
+    const uint64_t start = Stats::usecNow();
+    int events = 0;
+    while (joydev >= 0 && (len = read(joydev, msg, sizeof(msg))) > 0) {
+        const int count = len / sizeof(js_event);
+        dispatchEvents(msg, count);
+        events += count;
+        if (len < (ssize_t)sizeof(msg)) break;
+    }
+    finishEvents(events, start);
+}
+
+void JoyPad::replay(const js_event *events, int count) {
+    const uint64_t start = Stats::usecNow();
+    dispatchEvents(events, count);
+    finishEvents(count, start);
+}
+
+void JoyPad::dispatchEvents(const js_event *msg, int count) {
+    OutputScope scope(&stats);
+    for (int i = 0; i < count; ++ i) {
+        if (synced && (msg[i].type & JS_EVENT_INIT)) {
+            //the buffer overflowed, collect the state of everything
+            resyncEvents.append(msg[i]);
+            continue;
+        }
+        if (!resyncEvents.isEmpty()) resync();
         //pass that event on to the joypad!
-        jsevent(msg);
+        jsevent(msg[i]);
+    }
+}
+
+void JoyPad::finishEvents(int events, uint64_t start) {
+    OutputScope scope(&stats);
+    if (!resyncEvents.isEmpty()) resync();
+    synced = true;
+    //all stick events of a stick in this batch end up as one movement
+    const int moved = updateSticks();
+    if (events > 0) {
+        stats.addBatch(events, (stickEvents > moved) ? stickEvents - moved : 0,
+                       uint32_t(Stats::usecNow() - start));
     }
+    stickEvents = 0;
+    //everything this read caused goes out as one batch
+    flushevents();
+}
+
+void JoyPad::writeStats(QTextStream &stream) const {
+    stream << "Joystick " << (index + 1) << " (" << deviceId << "):\n";
+    stats.write(stream);
 }
 
 void JoyPad::releaseWidget() {
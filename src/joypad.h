@@ -4,6 +4,13 @@
 //parts of the joypad
 #include "button.h"
 #include "axis.h"
+#include "stickdata.h"
+#include "combodata.h"
+#include "macro.h"
+#include "stats.h"
+#include "screen.h"
+#include "gyrodata.h"
+#include "sensor.h"
 
 //the widget that will edit this
 #include "joypadw.h"
@@ -12,7 +19,10 @@
 #include "error.h"
 
 #include <QTextStream>
+#include <QHash>
 #include <QList>
+#include <QVector>
+#include <QTimer>
 #include <QSocketNotifier>
 
 class JoyPadWidget;
@@ -33,8 +43,14 @@ class JoyPad : public QObject {
 		void write( QTextStream &stream );
 		//release any pushed buttons and return to a neutral state
 		void release();
+		//look up the keys given as keysyms again, after the keyboard
+		//mapping changed
+		void resolveKeys();
 		//handle an event from the joystick device this is associated with
         void jsevent( const js_event& msg );
+		//handle events as if they were read from the device in one go, for
+		//the replay tool
+        void replay(const js_event *events, int count);
 		//reset to default settings
 		void toDefault();
 		//true iff this is currently at default settings
@@ -44,6 +60,11 @@ class JoyPad : public QObject {
         const QString& getDeviceId() const;
         QString getName() const;
         int getIndex() const;
+		//write the statistics of this device, for a snapshot
+        void writeStats(QTextStream &stream) const;
+		//use the motion sensors at path (see MotionSensor::find()), if the
+		//layout wants them
+        void openSensor(const QString &path);
 		
     private:
 
@@ -63,9 +84,98 @@ class JoyPad : public QObject {
 		//layouts with different numbers of axes/buttons than the current
 		//devices. Note that with the current layout settings, the defined
 		//buttons that don't actually exist on the device may not be contiguous.
+		//These are only views on the tables below, used for reading, writing
+		//and editing layouts.
         QList<Button*> buttons;
 	protected:
         QList<Axis*> axes;
+		//the state and settings of every axis and button, indexed by the
+		//number in the js_event. This is what actually handles events.
+        QVector<AxisData> axisData;
+        QVector<ButtonData> buttonData;
+		//how to map the values of every axis of the device to JOYMIN..JOYMAX.
+		//This belongs to the device, not the layout.
+        QVector<AxisCalibration> calibration;
+		//pairs of axes that move the mouse together, and for every axis the
+		//index of the stick it belongs to, or -1. The events of axes in a
+		//stick go to the stick instead of the axis table.
+        QVector<StickData> sticks;
+        QVector<int> axisStick;
+		//button combos, looked up by the exact set of buttons that is pressed
+        QVector<ComboData> combos;
+        QHash<quint64, int> comboLookup;
+		//one bit per pressed button, and the js_event time of each press
+        quint64 pressedButtons;
+        QVector<quint32> pressTime;
+		//the combo whose key is held down, or -1
+        int activeCombo;
+		//what this device did, and the number of stick events read since the
+		//sticks were last updated
+        DeviceStats stats;
+        int stickEvents;
+		//false until the state the device reports on open has been read. A
+		//JS_EVENT_INIT after that means the driver's buffer overflowed: it
+		//drops what was queued and reports the state of every control again,
+		//which is collected here and applied by resync().
+        bool synced;
+        QVector<js_event> resyncEvents;
+		//the macros of this layout, and a player for every button and axis
+		//direction that uses one. The players are made when a layout is
+		//loaded so nothing has to be allocated while they play.
+        QVector<MacroData> macros;
+        QList<MacroPlayer*> players;
+		//where the absolute axes put the mouse, one pointer for the whole
+		//screen and one for every monitor
+        AbsolutePointer pointers[MAXMONITORS + 1];
+		//the gyro of this device, and the motion sensors it reads. The sensor
+		//device is only kept open while the gyro is on, as it reports
+		//hundreds of frames a second.
+        GyroData gyro;
+        MotionSensor *sensor;
+        QString sensorPath;
+        void updateSensor();
+		//ask the driver whether it calibrates the axes, and fill in
+		//calibration for the ones it doesn't
+        void readCalibration();
+		//make sure there are at least count axes/buttons
+        void growAxes(int count);
+        void growButtons(int count);
+		//read/write one "Stick n:" line of a layout
+        bool readStick(QTextStream &stream, int num);
+        void writeStick(QTextStream &stream, int num);
+		//read/write the "Gyro:" line of a layout
+        bool readGyro(QTextStream &stream);
+        void writeGyro(QTextStream &stream);
+		//fill in axisStick from sticks
+        void bindSticks();
+		//read/write one "Combo n:" line of a layout
+        bool readCombo(QTextStream &stream, int num);
+        void writeCombo(QTextStream &stream, int num);
+		//rebuild comboLookup from combos
+        void compileCombos();
+		//read/write one "Macro n:" line of a layout
+        bool readMacro(QTextStream &stream, int num);
+        void writeMacro(QTextStream &stream, int num);
+		//give every button and axis that uses a macro its player, or take
+		//them all away
+        void compileMacros();
+        void clearMacros();
+		//keep track of the pressed buttons and fire combos. Returns true iff
+		//a layout is being loaded because of this.
+        bool comboEvent(int number, bool pressed, bool init, quint32 time);
+		//look up the keys given as keysyms. Returns true if any keycode
+		//differs, and only changes them if update is set.
+        bool resolveKeys(bool update);
+		//apply the state in resyncEvents, after events were lost
+        void resync();
+		//pass events read from the device on, and finish a batch of them
+		//once everything waiting was read. start is Stats::usecNow() from
+		//before the first read.
+        void dispatchEvents(const js_event *events, int count);
+        void finishEvents(int events, uint64_t start);
+		//bring the movement of the sticks up to date with the events read.
+		//Returns how many sticks actually moved.
+        int updateSticks();
 		//the index of this device (devicenum)
 		int index;
 		
@@ -80,6 +190,9 @@ class JoyPad : public QObject {
         void handleJoyEvents();
         void errorRead();
         void focusChange(bool windowHasFocus);
+    signals:
+        //a combo wants this layout to be loaded
+        void loadLayout(QString name);
 };
 
 #endif
@@ -42,6 +42,16 @@ JoyPadWidget::JoyPadWidget( JoyPad* jp, int i, QWidget* parent )
     btnAll = new QPushButton(tr("Quick Set"), this);
     layoutMain->addWidget(btnAll, insertCounter / 2, insertCounter % 2);
     connect(btnAll, SIGNAL(clicked()), this, SLOT(setAll()));
+
+    axisValues.fill(0, axes.size());
+    axisChanged.fill(false, axes.size());
+    buttonValues.fill(0, buttons.size());
+    buttonChanged.fill(false, buttons.size());
+    buttonLatched.fill(false, buttons.size());
+
+    refreshTimer.setSingleShot(true);
+    refreshTimer.setInterval(GUI_REFRESH_MSEC);
+    connect(&refreshTimer, SIGNAL(timeout()), this, SLOT(showState()));
 }
 
 JoyPadWidget::~JoyPadWidget() {
@@ -87,23 +97,67 @@ void JoyPadWidget::setAll() {
 }
 
 void JoyPadWidget::jsevent( const js_event& msg ) {
-    //notify the component this event applies to. this cannot generate anything
-    //other than a flash  :)
+    //just remember the event. The widgets are only told about it when the
+    //refresh timer runs out, so repainting doesn't follow the device's
+    //event rate.
     unsigned int type = msg.type & ~JS_EVENT_INIT;
     if (type == JS_EVENT_AXIS) {
-        if (msg.number < axes.size()) axes[msg.number]->jsevent(msg.value);
+        if (msg.number < axisValues.size()) {
+            axisValues[msg.number] = msg.value;
+            axisChanged[msg.number] = true;
+        }
         else debug_mesg("DEBUG: axis index out of range: %d\n", msg.value);
     }
     else if (type == JS_EVENT_BUTTON) {
-        if (msg.number < buttons.size()) buttons[msg.number]->jsevent(msg.value);
+        if (msg.number < buttonValues.size()) {
+            buttonValues[msg.number] = msg.value;
+            buttonChanged[msg.number] = true;
+            if (msg.value == 1) buttonLatched[msg.number] = true;
+        }
         else debug_mesg("DEBUG: button index out of range: %d\n", msg.value);
     }
+    if (!refreshTimer.isActive()) {
+        refreshTimer.start();
+    }
     //if we're doing quickset, it needs to know when we do something.
+    //this cannot wait, as it captures the very button that was pressed.
     if (quickset != NULL) {
         quickset->jsevent(msg);
     }
 }
 
+void JoyPadWidget::showState() {
+    //notify the components that changed. this cannot generate anything
+    //other than a flash  :)
+    for (int i = 0; i < axes.size(); ++ i) {
+        if (axisChanged[i]) {
+            axisChanged[i] = false;
+            axes[i]->jsevent(axisValues[i]);
+        }
+    }
+    bool again = false;
+    for (int i = 0; i < buttons.size(); ++ i) {
+        if (buttonChanged[i]) {
+            if (buttonLatched[i]) {
+                buttonLatched[i] = false;
+                buttons[i]->jsevent(1);
+                //released in the meantime: show that next time around
+                if (buttonValues[i] != 1) {
+                    again = true;
+                    continue;
+                }
+            }
+            else {
+                buttons[i]->jsevent(buttonValues[i]);
+            }
+            buttonChanged[i] = false;
+        }
+    }
+    if (again) {
+        refreshTimer.start();
+    }
+}
+
 void JoyPadWidget::updateButtonLayoutLists(const QStringList layoutNames) {
     foreach (ButtonWidget *bw, buttons) {
         bw->layoutNames = layoutNames;
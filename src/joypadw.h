@@ -5,6 +5,8 @@
 //Added by qt3to4:
 
 #include <QList>
+#include <QTimer>
+#include <QVector>
 #include <linux/joystick.h>
 #include "axisw.h"
 //this all relates to a JoyPad
@@ -24,7 +26,8 @@ class JoyPadWidget : public QWidget {
 	public:
 		JoyPadWidget( JoyPad* jp, int i, QWidget* parent);
 		~JoyPadWidget();
-		//takes in an event and decides whether or not to flash anything
+		//takes in an event and remembers it until the next time the state of
+		//the components is shown.
         void jsevent(const js_event &msg );
 		//Propagate changes in layout list
 		void updateButtonLayoutLists(const QStringList layoutNames);
@@ -38,6 +41,10 @@ class JoyPadWidget : public QWidget {
 		void clear();
 		//quickset!
 		void setAll();
+	private slots:
+		//pass the latest state of the changed axes and buttons on to their
+		//widgets. happens at most every GUI_REFRESH_MSEC (constant.h).
+		void showState();
 	signals:
 		//happens whenever the tab that represents this joypadwidget should flash
 		//(either on or off) The int is the index of this widget so that this
@@ -60,6 +67,16 @@ class JoyPadWidget : public QWidget {
         QList<AxisWidget*> axes;
         QList<ButtonWidget*> buttons;
         QPushButton *btnClear, *btnAll;
+
+		//the latest values received from the device, and which of them have
+		//not been shown yet. A button that was pressed and released again
+		//before it was shown is latched so that it still flashes.
+		QVector<int> axisValues;
+		QVector<int> buttonValues;
+		QVector<bool> axisChanged;
+		QVector<bool> buttonChanged;
+		QVector<bool> buttonLatched;
+		QTimer refreshTimer;
 		
 		//the quickset window, when we create it
 		QuickSet* quickset;
@@ -1,4 +1,5 @@
 #include "joyslider.h"
+#include "axisdata.h"
 //Added by qt3to4:
 
 JoySlider::JoySlider( int dz, int xz, int val, QWidget* parent )
@@ -22,17 +23,18 @@ JoySlider::JoySlider( int dz, int xz, int val, QWidget* parent )
     deadzone = dz;
     xzone = xz;
 
+    cacheValid = false;
+
     setMinimumHeight(20);
 }
 
 void JoySlider::setValue( int newval )
 {
-    //adjust the new position based on the throttle settings
-    if (throttle == 0) joyval = newval;
-    else if (throttle < 0) joyval = (newval + JOYMIN) / 2;
-    else joyval = (newval + JOYMAX) / 2;
-    //then redraw!
-    update();
+    int oldval = joyval;
+    //adjust the new position based on the throttle settings, like the axis
+    joyval = AxisData::throttled(throttle, newval);
+    //then redraw! Only the bar changes, the rest comes from the cache.
+    if (joyval != oldval) update();
 }
 
 void JoySlider::setThrottle( int newval )
@@ -41,7 +43,22 @@ void JoySlider::setThrottle( int newval )
     //status if the axis is not currently at zero, but these will be corrected
     //as soon as the axis moves again.
     throttle = newval;
-    update();
+    invalidateCache();
+}
+
+void JoySlider::setDeadZone( int newval )
+{
+    //dragging a tab lands on the same value for most mouse moves
+    if (newval == deadzone) return;
+    deadzone = newval;
+    invalidateCache();
+}
+
+void JoySlider::setXZone( int newval )
+{
+    if (newval == xzone) return;
+    xzone = newval;
+    invalidateCache();
 }
 
 int JoySlider::pointFor( int value, bool negative )
@@ -95,12 +112,27 @@ void JoySlider::resizeEvent( QResizeEvent* )
     tend = lboxstart + twidth - 1;
     rboxstart = lboxend + 5;
     rboxend = rboxstart + boxwidth - 1;
+    invalidateCache();
+}
+
+void JoySlider::changeEvent( QEvent* e )
+{
+    //the boxes look different when disabled or with another palette
+    if (e->type() == QEvent::EnabledChange || e->type() == QEvent::PaletteChange) {
+        invalidateCache();
+    }
+    QWidget::changeEvent( e );
 }
 
-void JoySlider::drawBox( int x, int width ) {
+void JoySlider::invalidateCache()
+{
+    cacheValid = false;
+    update();
+}
+
+void JoySlider::drawBox( QPainter &paint, int x, int width ) {
     //draws a nice, pretty, 3d-styled box. that takes up the full height of the
     //widget but is defined by x-coordinate and width
-    QPainter paint( this );
 
     paint.setPen( (isEnabled())?Qt::white:palette().window().color() );
     paint.setBrush( (isEnabled())?Qt::white:palette().window() );
@@ -123,24 +155,68 @@ void JoySlider::drawBox( int x, int width ) {
     paint.drawLine( x + width, 1 + boxheight, x + width, 1 );
 }
 
-void JoySlider::paintEvent( QPaintEvent* )
+void JoySlider::drawTab( QPainter &paint, int point ) {
+    QPolygon shape;
+    shape.putPoints(0,5,
+                    point, boxheight - 4,
+                    point + 3, boxheight - 1,
+                    point + 3, boxheight + 2,
+                    point - 3, boxheight + 2,
+                    point - 3, boxheight - 1);
+    paint.drawPolygon(shape);
+}
+
+void JoySlider::renderCache()
 {
-    //when we need to redraw,
-    //start by making our boxes
-    if (throttle == 0) {
-        drawBox( lboxstart, boxwidth );
-        drawBox( rboxstart, boxwidth );
+    const int ratio = devicePixelRatio();
+
+    boxes = QPixmap(size() * ratio);
+    boxes.setDevicePixelRatio(ratio);
+    boxes.fill(Qt::transparent);
+    {
+        QPainter paint( &boxes );
+        //start by making our boxes
+        if (throttle == 0) {
+            drawBox( paint, lboxstart, boxwidth );
+            drawBox( paint, rboxstart, boxwidth );
+        }
+        //or box, if we are in throttle mode.
+        else {
+            drawBox( paint, lboxstart, twidth );
+        }
     }
-    //or box, if we are in throttle mode.
-    else {
-        drawBox( lboxstart, twidth );
+
+    //now the tabs! We only need one set if we're doing a throttle mode
+    //but we need two if we're not. However, it's important to draw the right
+    //set of tabs depending on the mode! Negative throttle gets negative tabs.
+    tabs = QPixmap(size() * ratio);
+    tabs.setDevicePixelRatio(ratio);
+    tabs.fill(Qt::transparent);
+    {
+        QPainter paint( &tabs );
+        paint.setPen( Qt::black );
+        paint.setBrush( Qt::blue );
+        if (throttle >= 0) drawTab( paint, pointFor(deadzone, false) );
+        if (throttle <= 0) drawTab( paint, pointFor(deadzone, true) );
+
+        paint.setBrush( Qt::red );
+        if (throttle >= 0) drawTab( paint, pointFor(xzone, false) );
+        if (throttle <= 0) drawTab( paint, pointFor(xzone, true) );
     }
 
-    //if this is disabled, that's enough of that.
-    if (!isEnabled()) return;
+    cacheValid = true;
+}
+
+void JoySlider::paintEvent( QPaintEvent* )
+{
+    //when we need to redraw, bring the static parts up to date if needed
+    if (!cacheValid) renderCache();
 
-    //now we need to draw.
     QPainter paint( this );
+    paint.drawPixmap( 0, 0, boxes );
+
+    //if this is disabled, that's enough of that.
+    if (!isEnabled()) return;
 
     //prepare to draw a bar of the appropriate color
     QColor bar;
@@ -158,61 +234,8 @@ void JoySlider::paintEvent( QPaintEvent* )
     else if (joyval < 0)
         paint.drawRect( lboxstart + width - 2 - barlen, 3, barlen, boxheight - 3 );
 
-
-    //and now draw the tabs! We only need one set if we're doing a throttle mode
-    //but we need two if we're not. However, it's important to draw the right
-    //set of tabs depending on the mode! Negative throttle gets negative tabs.
-    int point;
-    QPolygon shape;
-
-    paint.setPen( Qt::black );
-    paint.setBrush( Qt::blue );
-    if (throttle >= 0) {
-        point = pointFor(deadzone, false);
-        shape.putPoints(0,5,
-                        point, boxheight - 4,
-                        point + 3, boxheight - 1,
-                        point + 3, boxheight + 2,
-                        point - 3, boxheight + 2,
-                        point - 3, boxheight - 1);
-        paint.drawPolygon(shape);
-    }
-
-    if (throttle <= 0) {
-        point = pointFor(deadzone, true);
-        shape.putPoints(0,5,
-                        point, boxheight - 4,
-                        point + 3, boxheight - 1,
-                        point + 3, boxheight + 2,
-                        point - 3, boxheight + 2,
-                        point - 3, boxheight - 1);
-        paint.drawPolygon(shape);
-    }
-
-
-
-    paint.setBrush( Qt::red );
-    if (throttle >= 0) {
-        point = pointFor(xzone, false);
-        shape.putPoints(0,5,
-                        point, boxheight - 4,
-                        point + 3, boxheight - 1,
-                        point + 3, boxheight + 2,
-                        point - 3, boxheight + 2,
-                        point - 3, boxheight - 1);
-        paint.drawPolygon(shape);
-    }
-
-    if (throttle <= 0) {
-        point = pointFor(xzone, true);
-        shape.putPoints(0,5,
-                        point, boxheight - 4,
-                        point + 3, boxheight - 1,
-                        point + 3, boxheight + 2,
-                        point - 3, boxheight + 2,
-                        point - 3, boxheight - 1);
-        paint.drawPolygon(shape);
-    }
+    //and the tabs go on top
+    paint.drawPixmap( 0, 0, tabs );
 }
 
 void JoySlider::mousePressEvent( QMouseEvent* e )
@@ -237,19 +260,17 @@ void JoySlider::mouseMoveEvent( QMouseEvent* e )
 {
     //get the x coordinate
     int xpt = e->x();
-    //if we're dragging, move the appropriate tab!
+    //if we're dragging, move the appropriate tab! The setters redraw.
     switch (dragState) {
     case DragXZ:
-        xzone = valueFrom( xpt );
+        setXZone( valueFrom( xpt ) );
         break;
 
     case DragDZ:
-        deadzone = valueFrom( xpt );
+        setDeadZone( valueFrom( xpt ) );
         break;
 
     default:
-        return;
+        break;
     }
-    //if we moved a tab, redraw!
-    update();
 }
@@ -8,6 +8,7 @@
 #include <QPaintEvent>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QPixmap>
 #include <QFrame>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
@@ -35,14 +36,19 @@ class JoySlider : public QWidget
 		void setValue( int );
 		//change the throttle mode
 		void setThrottle( int );
+		//move the dead and extreme zone marks
+		void setDeadZone( int );
+		void setXZone( int );
 		//get the current settings
         int deadZone() { return deadzone; }
         int xZone() { return xzone; }
 	protected:
 		//all for getting the widget to look right:
-		void drawBox( int x, int width );
+		void drawBox( QPainter &paint, int x, int width );
+		void drawTab( QPainter &paint, int point );
 		void paintEvent( QPaintEvent* );
 		void resizeEvent( QResizeEvent* );
+		void changeEvent( QEvent* e );
 		//for working with drag and drop:
 		void mousePressEvent( QMouseEvent* e );
 		void mouseReleaseEvent( QMouseEvent* );
@@ -76,6 +82,16 @@ class JoySlider : public QWidget
 		//the dead and extreme zone values
         int deadzone;
         int xzone;
+
+		//everything but the bar that shows the axis' position only changes
+		//when the settings or the size change, so it is drawn once into
+		//these pixmaps: the boxes go below the bar, the tabs above it.
+		void renderCache();
+		//throw away the cached pixmaps and redraw
+		void invalidateCache();
+		QPixmap boxes;
+		QPixmap tabs;
+		bool cacheValid;
 };
 
 
@@ -1,16 +1,20 @@
 #include <QX11Info>
+#include <QCoreApplication>
+#include <QHash>
+#include <xcb/xcb.h>
 #include "keycode.h"
 #include "keydialog.hpp"
 #include <X11/XKBlib.h>
 
-const QString ktos( int keycode )
-{
-    if (keycode > MAXKEY || keycode < 0) keycode = 0;
-
-    if (keycode == 0) return "[NO KEY]";
-
-    QString xname = XKeysymToString( XkbKeycodeToKeysym( QX11Info::display(), keycode, 0, 0 ) );
+//the names ktos() returns for every keycode, and the keycode of every
+//keysym. Built on first use and again after the keyboard mapping changed.
+static QString keyNames[MAXKEY + 1];
+static QHash<quint32, int> keysymCodes;
+static bool keymapValid = false;
 
+//turn an X11 key name into the one we show
+static QString prettyKeyName( const QString &xname )
+{
 //this section of code converts standard X11 keynames into much nicer names
 //which are prettier, fit the dialogs better, and are more readily understandable.
 //This is really ugly and I wish I didn't have to do this... that's why there
@@ -79,6 +83,112 @@ const QString ktos( int keycode )
     return xname;
 }
 
+static void buildKeymap()
+{
+    //without an X server (the replay tool) there is no mapping, and no key
+    //has a keysym
+    Display *display = QX11Info::display();
+    //start listening for changes before reading the mapping, so none is missed
+    if (display) KeymapWatcher::instance();
+    keyNames[0] = "[NO KEY]";
+    //one request for the whole mapping, instead of one per key
+    XkbDescPtr xkb = display ? XkbGetMap(display, XkbAllClientInfoMask, XkbUseCoreKbd) : 0;
+    keysymCodes.clear();
+    for (int keycode = 1; keycode <= MAXKEY; ++keycode) {
+        KeySym sym = NoSymbol;
+        if (xkb && keycode >= xkb->min_key_code && keycode <= xkb->max_key_code &&
+            XkbKeyNumSyms(xkb, keycode) > 0) {
+            sym = XkbKeySymEntry(xkb, keycode, 0, 0);
+            //like XKeysymToKeycode(), the lowest keycode with the keysym
+            //anywhere on it wins
+            const KeySym *syms = XkbKeySymsPtr(xkb, keycode);
+            for (int i = 0; i < XkbKeyNumSyms(xkb, keycode); ++i) {
+                if (syms[i] != NoSymbol && !keysymCodes.contains(syms[i])) {
+                    keysymCodes.insert(syms[i], keycode);
+                }
+            }
+        }
+        keyNames[keycode] = prettyKeyName(XKeysymToString(sym));
+    }
+    if (xkb) XkbFreeKeyboard(xkb, 0, True);
+    keymapValid = true;
+}
+
+const QString ktos( int keycode )
+{
+    if (keycode > MAXKEY || keycode < 0) keycode = 0;
+    if (!keymapValid) buildKeymap();
+    return keyNames[keycode];
+}
+
+void invalidateKeymap()
+{
+    keymapValid = false;
+}
+
+int keysymToKeycode( quint32 keysym )
+{
+    if (!keymapValid) buildKeymap();
+    return keysymCodes.value(keysym, 0);
+}
+
+bool readKey( const QString &word, int *keycode, quint32 *keysym )
+{
+    bool ok;
+    const int val = word.toInt(&ok);
+    if (ok) {
+        if (val < 0 || val > MAXKEY) return false;
+        *keycode = val;
+        *keysym = 0;
+        return true;
+    }
+    const KeySym sym = XStringToKeysym(word.toLatin1().constData());
+    if (sym == NoSymbol) return false;
+    *keysym = quint32(sym);
+    //0 if the keymap doesn't have it right now, but it may later
+    *keycode = keysymToKeycode(*keysym);
+    return true;
+}
+
+QString keyString( int keycode, quint32 keysym )
+{
+    if (keysym == 0) return QString::number(keycode);
+    const QString name = XKeysymToString(keysym);
+    //the digit keys are called "0" to "9", which would be read as keycodes
+    bool number;
+    name.toInt(&number);
+    if (name.isEmpty() || number) return "0x" + QString::number(keysym, 16);
+    return name;
+}
+
+KeymapWatcher::KeymapWatcher() {
+    int opcode, error;
+    int major = XkbMajorVersion, minor = XkbMinorVersion;
+    if (!XkbQueryExtension(QX11Info::display(), &opcode, &xkbEventBase, &error, &major, &minor)) {
+        xkbEventBase = -1;
+    }
+    QCoreApplication::instance()->installNativeEventFilter(this);
+}
+
+KeymapWatcher &KeymapWatcher::instance() {
+    static KeymapWatcher watcher;
+    return watcher;
+}
+
+bool KeymapWatcher::nativeEventFilter(const QByteArray &eventType, void *message, long *) {
+    if (eventType != "xcb_generic_event_t") return false;
+    const xcb_generic_event_t *event = static_cast<const xcb_generic_event_t*>(message);
+    const int type = event->response_type & ~0x80;
+    //the second byte of an XKB event says which one it is
+    if (type == XCB_MAPPING_NOTIFY ||
+        (type == xkbEventBase && (event->pad0 == XkbNewKeyboardNotify || event->pad0 == XkbMapNotify))) {
+        invalidateKeymap();
+        emit changed();
+    }
+    //Qt needs to see these too
+    return false;
+}
+
 
 KeyButton::KeyButton( QString name, int val, QWidget* parent, bool m, bool nowMouse)
         :QPushButton(nowMouse?tr("Mouse %1").arg(val):ktos(val), parent) {
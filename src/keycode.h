@@ -6,12 +6,38 @@
 #include <QDialog>
 #include <QPaintEvent>
 #include <QPainter>
+#include <QAbstractNativeEventFilter>
 
 
 #include "constant.h"
 
-//Produce a string for any keycode
+//Produce a string for any keycode. The names of all keys are looked up at
+//once and kept until the keyboard mapping changes.
 const QString ktos( int keycode );
+//forget the names, they are looked up again on next use
+void invalidateKeymap();
+
+//keys in layouts are either keycodes ("38") or keysym names ("a", "Left"),
+//which are looked up in the current keymap. readKey() returns false for
+//anything else, and a keysym of 0 for keycodes. keyString() is the other way.
+bool readKey( const QString &word, int *keycode, quint32 *keysym );
+QString keyString( int keycode, quint32 keysym );
+//the keycode that types keysym right now, or 0 if there is none
+int keysymToKeycode( quint32 keysym );
+
+//tells when the keyboard mapping of the X server changes
+class KeymapWatcher : public QObject, public QAbstractNativeEventFilter {
+	Q_OBJECT
+	public:
+		static KeymapWatcher &instance();
+		bool nativeEventFilter(const QByteArray &eventType, void *message, long *result);
+	signals:
+		void changed();
+	private:
+		KeymapWatcher();
+		//where the XKB events start, or -1 if there's no XKB
+		int xkbEventBase;
+};
 
 
 //a button that requests a keycode from the user when clicked.
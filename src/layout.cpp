@@ -1,11 +1,16 @@
+#include <stdio.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include <QFileDialog>
+#include <QMap>
+#include <QSet>
 
 #include "layout.h"
+#include "motion.h"
 #include "config.h"
 
 
@@ -17,8 +22,24 @@ LayoutManager::LayoutManager( bool useTrayIcon, const QString &devdir, const QSt
       updateLayoutsAction(new QAction(QIcon::fromTheme("view-refresh"),tr("Update &Layout List"),this)),
       addNewConfiguration(new QAction(QIcon::fromTheme("list-add"),tr("Add new configuration"),this)),
       quitAction(new QAction(QIcon::fromTheme("application-exit"),tr("&Quit"),this)),
+      noLayoutAction(0),
+      layoutsEnd(0),
+      layoutsChanged(true),
       le(0) {
 
+    deviceUiTimer.setSingleShot(true);
+    deviceUiTimer.setInterval(HOTPLUG_SETTLE_MSEC);
+    connect(&deviceUiTimer, SIGNAL(timeout()), this, SLOT(refreshDeviceUi()));
+    schedulerTimer.setSingleShot(true);
+    schedulerTimer.setTimerType(Qt::PreciseTimer);
+    connect(&schedulerTimer, SIGNAL(timeout()), this, SLOT(runScheduler()));
+    Scheduler::instance().setWaker(this);
+    keymapTimer.setSingleShot(true);
+    keymapTimer.setInterval(0);
+    connect(&keymapTimer, SIGNAL(timeout()), this, SLOT(keymapChanged()));
+    connect(&KeymapWatcher::instance(), SIGNAL(changed()), &keymapTimer, SLOT(start()));
+    debug_mesg("using the %s mouse motion kernel\n", MotionBatch::kernelName());
+
 #ifdef WITH_LIBUDEV
     udevNotifier = 0;
     udev = 0;
@@ -30,8 +51,9 @@ LayoutManager::LayoutManager( bool useTrayIcon, const QString &devdir, const QSt
     }
 #endif
 
-    //prepare the popup first.
-    fillPopup();
+    //prepare the popup first. The layout entries are filled in the first
+    //time it is shown.
+    buildPopup();
 
     //make a tray icon
     if (useTrayIcon) {
@@ -50,6 +72,8 @@ LayoutManager::LayoutManager( bool useTrayIcon, const QString &devdir, const QSt
         icon->show();
     }
 
+    connect(&trayMenu, SIGNAL(aboutToShow()), this, SLOT(updatePopup()));
+    connect(layoutGroup, SIGNAL(triggered(QAction*)), this, SLOT(layoutTriggered(QAction*)));
     connect(updateLayoutsAction, SIGNAL(triggered()), this, SLOT(fillPopup()));
     connect(updateDevicesAction, SIGNAL(triggered()), this, SLOT(updateJoyDevs()));
     connect(addNewConfiguration,  SIGNAL(triggered()), this, SLOT(addNewConfig()));
@@ -60,6 +84,7 @@ LayoutManager::LayoutManager( bool useTrayIcon, const QString &devdir, const QSt
 }
 
 LayoutManager::~LayoutManager() {
+    Scheduler::instance().setWaker(0);
     if (le) {
         le->close();
         le = 0;
@@ -127,33 +152,54 @@ bool LayoutManager::initUDev() {
 }
 
 void LayoutManager::udevUpdate() {
-    struct udev_device *dev = udev_monitor_receive_device(monitor);
-    if (dev) {
-        QRegExp devicename("/js(\\d+)$");
+    //a hub full of pads produces a whole burst of events for one wakeup, so
+    //drain the monitor and collapse the burst into one change per device.
+    //the value is the device node to (re)open, or a null string if the
+    //device went away.
+    QMap<int, QString> changes;
+    QSet<int> reopen;
+    QRegExp devicename("/js(\\d+)$");
+    struct udev_device *dev;
+
+    while ((dev = udev_monitor_receive_device(monitor)) != 0) {
         QString path = udev_device_get_devnode(dev);
         const char *action = udev_device_get_action(dev);
 
-        if (devicename.indexIn(path) >= 0) {
+        if (action && devicename.indexIn(path) >= 0) {
             int index = devicename.cap(1).toInt();
 
             if (strcmp(action,"add") == 0 || strcmp(action,"online") == 0) {
-                addJoyPad(index, path);
+                changes.insert(index, path);
             }
             else if (strcmp(action,"remove") == 0 || strcmp(action,"offline") == 0) {
-                removeJoyPad(index);
+                changes.insert(index, QString());
+                reopen.remove(index);
             }
             else if (strcmp(action,"change") == 0) {
-                removeJoyPad(index);
-                addJoyPad(index, path);
+                changes.insert(index, path);
+                reopen.insert(index);
             }
+        }
+        udev_device_unref(dev);
+    }
 
-            fillPopup();
-            if (le) {
-                le->updateJoypadWidgets();
+    if (changes.isEmpty()) return;
+
+    //apply the whole batch right away so input works as soon as possible,
+    //the (slow) UI rebuild is done later, once for the whole burst.
+    for (QMap<int, QString>::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++ it) {
+        if (it.value().isNull()) {
+            removeJoyPad(it.key());
+        }
+        else {
+            if (reopen.contains(it.key())) {
+                removeJoyPad(it.key());
             }
+            addJoyPad(it.key(), it.value());
         }
-        udev_device_unref(dev);
     }
+
+    scheduleDeviceUiRefresh();
 }
 #endif
 
@@ -232,7 +278,9 @@ bool LayoutManager::load(const QString& name) {
             int index = num - 1;
             //if there was no joypad defined for this index before, make it now!
             if (joypads[index] == 0) {
-                joypads.insert(index, new JoyPad(index, -1, this));
+                JoyPad *joypad = new JoyPad(index, -1, this);
+                connect(joypad, &JoyPad::loadLayout, this, &LayoutManager::loadLayoutFromButton);
+                joypads.insert(index, joypad);
             }
             //try to read the joypad, report error on fail.
             if (!joypads[index]->readConfig(stream)) {
@@ -435,6 +483,31 @@ void LayoutManager::saveDefault() {
     }
 }
 
+void LayoutManager::writeStats() {
+    //written next to the file and then moved over it, so whoever is waiting
+    //for it never sees half of it
+    const QString fileName = settingsDir + "stats";
+    QFile file(fileName + ".new");
+    if (!file.open(QIODevice::WriteOnly)) return;
+    QTextStream stream(&file);
+    Stats::instance().write(stream);
+    foreach (JoyPad *joypad, joypads) {
+        if (joypad) joypad->writeStats(stream);
+    }
+    stream.flush();
+    file.close();
+    ::rename(QFile::encodeName(file.fileName()).constData(),
+             QFile::encodeName(fileName).constData());
+}
+
+void LayoutManager::statsRequested(int fd) {
+    //however many signals came in, one snapshot answers them all
+    char buffer[64];
+    while (read(fd, buffer, sizeof(buffer)) > 0) {
+    }
+    writeStats();
+}
+
 void LayoutManager::remove() {
     if (currentLayout.isNull()) return;
     if (QMessageBox::warning(le, tr("Delete layout? - %1").arg(QJOYPAD_NAME),
@@ -505,15 +578,13 @@ QStringList LayoutManager::getLayoutNames() const {
 }
 
 void LayoutManager::setLayoutName(const QString& name) {
-    QList<QAction*> actions = layoutGroup->actions();
-    for (int i = 0; i < actions.size(); ++ i) {
-        QAction* action = actions[i];
-        if (action->data().toString() == name) {
-            action->setChecked(true);
-            break;
-        }
+    //switching layouts only moves the check mark
+    QAction *action = name.isNull() ? noLayoutAction : layoutActions.value(name);
+    if (action) {
+        action->setChecked(true);
     }
     currentLayout = name;
+    statAdd(Stats::instance().layoutSwitches);
 
     if (le) {
         le->setLayout(name);
@@ -537,48 +608,26 @@ void LayoutManager::trayClick(QSystemTrayIcon::ActivationReason reason) {
     }
 }
 
-void LayoutManager::layoutTriggered() {
-    QAction *action = qobject_cast<QAction*>(sender());
+void LayoutManager::layoutTriggered(QAction *action) {
     //if they clicked on a Layout name, load it!
     if (action) {
         load(action->data().toString());
     }
 }
 
-void LayoutManager::fillPopup() {
-    //start with an empty slate
-    trayMenu.clear();
-
+void LayoutManager::buildPopup() {
     //add in the Update options
     trayMenu.addAction(updateLayoutsAction);
     trayMenu.addAction(updateDevicesAction);
     trayMenu.addSeparator();
 
     //add null layout
-    QAction *action = trayMenu.addAction(tr("[NO LAYOUT]"));
-    action->setCheckable(true);
-    action->setActionGroup(layoutGroup);
-    //put a check by the current one  ;)
-    if (currentLayout.isNull()) {
-        action->setChecked(true);
-    }
-    connect(action, SIGNAL(triggered()), this, SLOT(layoutTriggered()));
-
-    //then add all the layout names
-    foreach (const QString &name, getLayoutNames()) {
-        QString title = name;
-        title.replace('&',"&&");
-        action = trayMenu.addAction(title);
-        action->setData(name);
-        action->setCheckable(true);
-        action->setActionGroup(layoutGroup);
-        //put a check by the current one  ;)
-        if (currentLayout == name) {
-            action->setChecked(true);
-        }
-        connect(action, SIGNAL(triggered()), this, SLOT(layoutTriggered()));
-    }
-    trayMenu.addSeparator();
+    noLayoutAction = trayMenu.addAction(tr("[NO LAYOUT]"));
+    noLayoutAction->setCheckable(true);
+    noLayoutAction->setActionGroup(layoutGroup);
+
+    //the layout names go here
+    layoutsEnd = trayMenu.addSeparator();
 
     trayMenu.addAction(addNewConfiguration);
     trayMenu.addSeparator();
@@ -587,6 +636,59 @@ void LayoutManager::fillPopup() {
     trayMenu.addAction(quitAction);
 }
 
+void LayoutManager::fillPopup() {
+    layoutsChanged = true;
+    //if the menu is open right now, don't wait for the next time it is shown
+    if (trayMenu.isVisible()) {
+        updatePopup();
+    }
+}
+
+void LayoutManager::updatePopup() {
+    if (!layoutsChanged) return;
+    layoutsChanged = false;
+
+    QStringList names = getLayoutNames();
+    if (names == layoutNames) return;
+
+    //drop the entries of layouts that are gone
+    QSet<QString> nameSet;
+    foreach (const QString &name, names) {
+        nameSet.insert(name);
+    }
+    foreach (const QString &name, layoutNames) {
+        if (!nameSet.contains(name)) {
+            delete layoutActions.take(name);
+        }
+    }
+
+    //and add entries for new layouts, keeping the menu in the same order as
+    //the list of names. Entries that are already there are left alone.
+    QAction *before = layoutsEnd;
+    for (int i = names.size() - 1; i >= 0; -- i) {
+        const QString &name = names[i];
+        QAction *action = layoutActions.value(name);
+        if (!action) {
+            QString title = name;
+            title.replace('&',"&&");
+            action = new QAction(title, this);
+            action->setData(name);
+            action->setCheckable(true);
+            action->setActionGroup(layoutGroup);
+            trayMenu.insertAction(before, action);
+            layoutActions.insert(name, action);
+        }
+        before = action;
+    }
+    layoutNames = names;
+
+    //put a check by the current one  ;)
+    QAction *current = currentLayout.isNull() ? noLayoutAction : layoutActions.value(currentLayout);
+    if (current) {
+        current->setChecked(true);
+    }
+}
+
 void LayoutManager::updateJoyDevs() {
     debug_mesg("updating joydevs\n");
 
@@ -669,13 +771,45 @@ void LayoutManager::updateJoyDevs() {
 #ifdef WITH_LIBUDEV
     }
 #endif
-    //when it's all done, rebuild the popup menu so it displays the correct
-    //information.
-    fillPopup();
+    //when it's all done, rebuild the editor so it displays the correct
+    //information. this also covers any hotplug rebuild still pending.
+    deviceUiTimer.stop();
+    refreshDeviceUi();
+    debug_mesg("done updating joydevs\n");
+}
+
+void LayoutManager::wakeAt(int64_t deadline) {
+    if (deadline < 0) {
+        schedulerTimer.stop();
+    }
+    else {
+        const int64_t delay = deadline - Scheduler::instance().now();
+        schedulerTimer.start(delay > 0 ? int(delay) : 0);
+    }
+}
+
+void LayoutManager::runScheduler() {
+    Scheduler::instance().runDue();
+    flushevents();
+}
+
+void LayoutManager::keymapChanged() {
+    foreach (JoyPad *joypad, joypads) {
+        joypad->resolveKeys();
+    }
+    flushevents();
+}
+
+void LayoutManager::scheduleDeviceUiRefresh() {
+    //restarting the timer pushes the rebuild to the end of the burst
+    deviceUiTimer.start();
+}
+
+void LayoutManager::refreshDeviceUi() {
+    //the popup menu doesn't list any devices, only the editor needs updating
     if (le) {
         le->updateJoypadWidgets();
     }
-    debug_mesg("done updating joydevs\n");
 }
 
 void LayoutManager::addNewConfig() {
@@ -711,6 +845,7 @@ void LayoutManager::addJoyPad(int index, const QString& devpath) {
         //if we've never seen this device before, make a new one!
         if (joypad == 0) {
             joypad = new JoyPad( index, joydev, this );
+            connect(joypad, &JoyPad::loadLayout, this, &LayoutManager::loadLayoutFromButton);
             foreach (Button *button, joypad->buttons) {
                 connect(button, &Button::loadLayout, this, &LayoutManager::loadLayoutFromButton);
             }
@@ -720,6 +855,8 @@ void LayoutManager::addJoyPad(int index, const QString& devpath) {
             debug_mesg("found previously open joypad with index %d, ignoring", index);
             joypad->open(joydev);
         }
+        //the motion sensors are a device of their own
+        joypad->openSensor(MotionSensor::find(devdir, index, joypad->getDeviceId()));
         //make this joystick device available.
         available.insert(index,joypad);
     }
@@ -729,7 +866,7 @@ void LayoutManager::addJoyPad(int index, const QString& devpath) {
 }
 
 void LayoutManager::removeJoyPad(int index) {
-    JoyPad *joypad = available[index];
+    JoyPad *joypad = available.value(index);
     if (joypad) {
         joypad->close();
         available.remove(index);
@@ -16,6 +16,7 @@
 #include <QPointer>
 #include <QInputDialog>
 #include <QSystemTrayIcon>
+#include <QTimer>
 
 #include "config.h"
 
@@ -25,6 +26,7 @@
 
 //a layout handles several joypads
 #include "joypad.h"
+#include "scheduler.h"
 //for errors
 #include "error.h"
 //For displaying a floating icon instead of a tray icon
@@ -33,7 +35,7 @@
 #include "layout_edit.h"
 
 //handles loading, saving, and changing of layouts
-class LayoutManager : public QObject {
+class LayoutManager : public QObject, public Scheduler::Waker {
 	friend class LayoutEdit;
 	Q_OBJECT
 	public:
@@ -64,6 +66,9 @@ class LayoutManager : public QObject {
 		void importLayout();
 		//save the currently loaded layout so it can be recalled later
 		void saveDefault();
+		//write a snapshot of the statistics to the "stats" file in the
+		//settings directory
+		void writeStats();
 
 		//get rid of a layout
 		void remove();
@@ -73,7 +78,8 @@ class LayoutManager : public QObject {
 		//when the tray icon is clicked
 		void iconClick();
         void trayClick(QSystemTrayIcon::ActivationReason reason);
-		//rebuild the popup menu with the current information
+		//mark the layout list of the popup menu as outdated. The menu itself
+		//is only brought up to date when it is about to be shown.
 		void fillPopup();
 		//update the list of available joystick devices
 		void updateJoyDevs();
@@ -81,8 +87,22 @@ class LayoutManager : public QObject {
                 void addNewConfig();
     private slots:
         //when the user selects an item on the tray's popup menu
-        void layoutTriggered();
+        void layoutTriggered(QAction *action);
+        //bring the layout entries of the popup menu up to date, if needed
+        void updatePopup();
+        //rebuild the parts of the UI that list devices, once a hotplug burst is over
+        void refreshDeviceUi();
+        //run whatever the scheduler has due
+        void runScheduler();
+        //look up the keys that layouts give as keysyms again
+        void keymapChanged();
+        //SIGRTMIN came in and wrote to fd, see main.cpp
+        void statsRequested(int fd);
     private:
+        //build the fixed entries of the popup menu
+        void buildPopup();
+        //ask for refreshDeviceUi() once no more device changes come in
+        void scheduleDeviceUiRefresh();
         void addJoyPad(int index);
         void addJoyPad(int index, const QString& devpath);
         void removeJoyPad(int index);
@@ -103,6 +123,14 @@ class LayoutManager : public QObject {
         QAction *updateLayoutsAction;
         QAction *addNewConfiguration;
         QAction *quitAction;
+        QAction *noLayoutAction;
+        //layout entries are inserted before this separator
+        QAction *layoutsEnd;
+        //the layout names the popup menu currently shows and their entries.
+        //these are reused when the menu is updated.
+        QStringList layoutNames;
+        QHash<QString, QAction*> layoutActions;
+        bool layoutsChanged;
 
 		//if there is a LayoutEdit open, this points to it. Otherwise, NULL.	
         QPointer<LayoutEdit> le;
@@ -110,6 +138,18 @@ class LayoutManager : public QObject {
         QHash<int, JoyPad*> available;
         QHash<int, JoyPad*> joypads;
 
+        //debounces UI rebuilds while devices are being (un)plugged
+        QTimer deviceUiTimer;
+        //wakes the Scheduler up at its next deadline. This is the only timer
+        //that runs while devices are in use (mouse movement, pwm, macros and
+        //rapidfire all go through the Scheduler), and it stops once they're
+        //all idle.
+        QTimer schedulerTimer;
+        void wakeAt(int64_t deadline);
+        //the X server sends several notifications for one keymap change,
+        //this makes them one keymapChanged()
+        QTimer keymapTimer;
+
 #ifdef WITH_LIBUDEV
         bool initUDev();
         QSocketNotifier *udevNotifier;
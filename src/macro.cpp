@@ -0,0 +1,96 @@
+#include <string.h>
+
+#include "macro.h"
+
+MacroData::MacroData() {
+    delay = 0;
+    cancelOnRelease = false;
+    repeat = false;
+}
+
+MacroPlayer::MacroPlayer(const MacroData *macro)
+    : macro(macro), pos(0), held(false), playing(false) {
+    memset(keysDown, 0, sizeof(keysDown));
+    memset(buttonsDown, 0, sizeof(buttonsDown));
+}
+
+void MacroPlayer::press() {
+    held = true;
+    //a macro that is still playing goes on where it is
+    if (playing) return;
+    playing = true;
+    pos = 0;
+    Scheduler &scheduler = Scheduler::instance();
+    if (macro->delay > 0) {
+        scheduler.schedule(this, scheduler.now() + macro->delay);
+    }
+    else {
+        play(scheduler.now());
+    }
+}
+
+void MacroPlayer::release() {
+    held = false;
+    if (macro->cancelOnRelease) {
+        stop();
+    }
+}
+
+void MacroPlayer::stop() {
+    Scheduler::instance().cancel(this);
+    playing = false;
+    FakeEvent e;
+    for (int i = 0; i < 256; ++ i) {
+        if (keysDown[i / 64] & (uint64_t(1) << (i % 64))) {
+            e.type = FakeEvent::KeyUp;
+            e.keycode = i;
+            send(e);
+        }
+        if (buttonsDown[i / 64] & (uint64_t(1) << (i % 64))) {
+            e.type = FakeEvent::MouseUp;
+            e.keycode = i;
+            send(e);
+        }
+    }
+}
+
+void MacroPlayer::fire(int64_t) {
+    play(when());
+}
+
+void MacroPlayer::play(int64_t time) {
+    for (;;) {
+        while (pos < macro->steps.size()) {
+            const MacroStep &step = macro->steps[pos++];
+            send(step.event);
+            if (step.delay > 0) {
+                Scheduler::instance().schedule(this, time + step.delay);
+                return;
+            }
+        }
+        //the layout makes sure a repeating macro takes some time, so this
+        //can't spin
+        if (!(macro->repeat && held)) break;
+        pos = 0;
+        if (macro->delay > 0) {
+            Scheduler::instance().schedule(this, time + macro->delay);
+            return;
+        }
+    }
+    playing = false;
+}
+
+void MacroPlayer::send(const FakeEvent &e) {
+    if (e.type != FakeEvent::MouseMove && e.type != FakeEvent::MouseMoveAbsolute) {
+        const int code = e.keycode & 255;
+        const uint64_t bit = uint64_t(1) << (code % 64);
+        switch (e.type) {
+        case FakeEvent::KeyDown: keysDown[code / 64] |= bit; break;
+        case FakeEvent::KeyUp: keysDown[code / 64] &= ~bit; break;
+        case FakeEvent::MouseDown: buttonsDown[code / 64] |= bit; break;
+        case FakeEvent::MouseUp: buttonsDown[code / 64] &= ~bit; break;
+        default: break;
+        }
+    }
+    sendevent(e);
+}
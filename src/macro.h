@@ -0,0 +1,63 @@
+#ifndef QJOYPAD_MACRO_H
+#define QJOYPAD_MACRO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "event.h"
+#include "scheduler.h"
+
+//one fake event of a macro, and how long to wait after it
+struct MacroStep {
+    FakeEvent event;
+    int delay;
+    //the keysym the keycode of a key step was looked up for, 0 if the
+    //layout gave a keycode
+    uint32_t keysym;
+};
+
+//a sequence of fake events with delays in between, as read from a layout
+struct MacroData {
+    MacroData();
+
+    //how long to wait before the first step
+    int delay;
+    std::vector<MacroStep> steps;
+    //stop playing (and let go of everything) when the control is released
+    bool cancelOnRelease;
+    //start over when the end is reached, for as long as the control is held
+    bool repeat;
+};
+
+//plays a macro for one button or axis direction. Everything is worked out
+//relative to the deadline of the previous step, so the timing doesn't drift
+//with the load of the system, and nothing is allocated while playing.
+class MacroPlayer : public Scheduler::Entry {
+    public:
+        MacroPlayer(const MacroData *macro);
+        //the control was pressed
+        void press();
+        //the control was released
+        void release();
+        //stop playing and release every key and mouse button the macro holds
+        void stop();
+        bool isPlaying() const { return playing; }
+
+        void fire(int64_t now);
+
+    private:
+        //run steps from pos on, where time is when the current step is due
+        void play(int64_t time);
+        void send(const FakeEvent &e);
+
+        const MacroData *macro;
+        size_t pos;
+        bool held;
+        bool playing;
+        //the keys and mouse buttons this macro currently holds down
+        uint64_t keysDown[4];
+        uint64_t buttonsDown[4];
+};
+
+#endif
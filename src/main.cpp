@@ -4,9 +4,13 @@
 //to create and handle signals for various events
 #include <signal.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
 
 //to create a qapplication
 #include <QFile>
+#include <QSocketNotifier>
 #include <QSystemTrayIcon>
 #include <QPointer>
 #include <QFileInfo>
@@ -16,12 +20,16 @@
 #include "layout.h"
 //to give event.h the current X11 display
 #include "event.h"
+//to send the fake events from a thread of their own
+#include "output.h"
 //to produce errors!
 #include "error.h"
 #include "config.h"
 
 //variables needed in various functions in this file
 QPointer<LayoutManager> layoutManagerPtr;
+//SIGRTMIN writes to one end, the event loop reads from the other
+static int statsPipe[2] = { -1, -1 };
 
 //signal handler for SIGUSR2
 //SIGUSR2 means that a new layout should be loaded. It is saved in
@@ -43,9 +51,47 @@ void catchSIGUSR1( int sig ) {
     signal( sig, catchSIGUSR1 );
 }
 
+//signal handler for SIGRTMIN (both user signals are taken)
+//SIGRTMIN means that a snapshot of the statistics should be written. The
+//signal can come while the GUI thread is in the middle of changing what the
+//snapshot reads, so this only wakes up the event loop through statsPipe and
+//LayoutManager::statsRequested() writes the snapshot from there.
+void catchSIGRTMIN( int sig ) {
+    const int saved = errno;
+    const char byte = 0;
+    //if the pipe is full, a snapshot is on its way anyway
+    const ssize_t written = write(statsPipe[1], &byte, 1);
+    (void)written;
+    errno = saved;
+    //remember to catch this signal again next time.
+    signal( sig, catchSIGRTMIN );
+}
+
+//ask the running instance pid for a snapshot of its statistics and print it
+//once it's there.
+static void printStats( int pid, const QString &settingsDir ) {
+    QFile file( settingsDir + "stats" );
+    file.remove();
+    kill(pid,SIGRTMIN);
+    //give it a moment to write the file
+    for (int i = 0; i < STATS_WAIT_MSEC / 10 && !file.exists(); ++i) {
+        usleep(10000);
+    }
+    if (file.open( QIODevice::ReadOnly )) {
+        printf("%s", file.readAll().constData());
+        file.close();
+    }
+    else {
+        fprintf(stderr, "%s", qPrintable(QApplication::translate("main",
+            "QJoyPad (pid %1) did not answer.\n").arg(pid)));
+    }
+}
 
 int main( int argc, char **argv )
 {
+    //the output thread has a display connection of its own
+    XInitThreads();
+
     //create a new event loop. This will be captured by the QApplication
     //when it gets created
     QApplication app( argc, argv );
@@ -99,6 +145,8 @@ int main( int argc, char **argv )
     //this execution wasn't made to update the joystick device list.
     bool update = false;
     bool forceTrayIcon = false;
+    //this execution wasn't made to print the statistics of a running instance.
+    bool stats = false;
 
     //parse command-line options
     struct option long_options[] = {
@@ -107,11 +155,12 @@ int main( int argc, char **argv )
         {"force-tray", no_argument,       0, 't'},
         {"notray",     no_argument,       0, 'T'},
         {"update",     no_argument,       0, 'u'},
+        {"stats",      no_argument,       0, 's'},
         {0,            0,                 0,  0 }
     };
 
     for (;;) {
-        int c = getopt_long(argc, argv, "hd:tTu", long_options, NULL);
+        int c = getopt_long(argc, argv, "hd:tTus", long_options, NULL);
 
         if (c == -1)
             break;
@@ -119,7 +168,7 @@ int main( int argc, char **argv )
         switch (c) {
             case 'h':
                 printf("%s", qPrintable(app.translate("main","%1\n"
-                    "Usage: %2 [--device=\"/device/path\"] [--notray|--force-tray] [\"layout name\"]\n"
+                    "Usage: %2 [--device=\"/device/path\"] [--notray|--force-tray] [--stats] [\"layout name\"]\n"
                     "\n"
                     "Options:\n"
                     "  -h, --help            Print this help message.\n"
@@ -131,6 +180,9 @@ int main( int argc, char **argv )
                     "                        window managers that don't support this feature.\n"
                     "  -u, --update          Force a running instance of QJoyPad to update its\n"
                     "                        list of devices and layouts.\n"
+                    "  -s, --stats           Print what a running instance of QJoyPad has\n"
+                    "                        been doing: events read and sent, latencies,\n"
+                    "                        wakeups and so on.\n"
                     "  \"layout name\"         Load the given layout in an already running\n"
                     "                        instance of QJoyPad, or start QJoyPad using the\n"
                     "                        given layout.\n").arg(QJOYPAD_NAME, argc > 0 ? argv[0] : "qjoypad")));
@@ -160,6 +212,10 @@ int main( int argc, char **argv )
                 update = true;
                 break;
 
+            case 's':
+                stats = true;
+                break;
+
             case '?':
                 fprintf(stderr, "%s", qPrintable(app.translate("main",
                     "Illeagal argument.\n"
@@ -213,7 +269,7 @@ int main( int argc, char **argv )
                 //then prevent two instances from running at once.
                 //however, if we are setting the layout or updating the device
                 //list, this is not an error and we shouldn't make one!
-                if (layout.isEmpty() && !update)
+                if (layout.isEmpty() && !update && !stats)
                     errorBox(app.translate("main","Instance Error"),
                              app.translate("main","There is already a running instance of QJoyPad; please close\nthe old instance before starting a new one."));
                 else {
@@ -224,12 +280,22 @@ int main( int argc, char **argv )
                     if (!layout.isEmpty()) {
                         kill(pid,SIGUSR2);
                     }
+                    if (stats) {
+                        printStats(pid, settingsDir);
+                    }
                 }
                 //and quit. We don't need two instances.
                 return 0;
             }
         }
     }
+    //there is nobody to ask for statistics
+    if (stats) {
+        fprintf(stderr, "%s", qPrintable(app.translate("main",
+            "There is no running instance of QJoyPad.\n")));
+        return 1;
+    }
+
     //now we can try to create and write our pid to the lock file.
     if (pidFile.open( QIODevice::WriteOnly ))
     {
@@ -251,6 +317,11 @@ int main( int argc, char **argv )
     }
     //create a new LayoutManager with a tray icon / floating icon, depending
     //on the user's request
+    //start sending fake events from their own thread. It has to outlive the
+    //LayoutManager, which releases everything when it goes.
+    OutputThread output;
+    output.open();
+
     LayoutManager layoutManager(useTrayIcon,devdir,settingsDir);
     layoutManagerPtr = &layoutManager;
 
@@ -264,6 +335,16 @@ int main( int argc, char **argv )
     //prepare the signal handlers
     signal( SIGUSR1, catchSIGUSR1 );
     signal( SIGUSR2, catchSIGUSR2 );
+    if (pipe2(statsPipe, O_NONBLOCK | O_CLOEXEC) == 0) {
+        QSocketNotifier *statsNotifier =
+            new QSocketNotifier(statsPipe[0], QSocketNotifier::Read, &layoutManager);
+        QObject::connect(statsNotifier, SIGNAL(activated(int)),
+                         &layoutManager, SLOT(statsRequested(int)));
+        signal( SIGRTMIN, catchSIGRTMIN );
+    }
+    else {
+        debug_mesg("pipe2: %s, --stats won't be answered\n", strerror(errno));
+    }
 
     //and run the program!
     int result = app.exec();
@@ -0,0 +1,427 @@
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QJOYPAD_MOTION_X86
+#include <immintrin.h>
+#endif
+
+#include "motion.h"
+#include "event.h"
+#include "stats.h"
+
+//the widest vector we have a kernel for, in lanes. The lanes are padded to
+//a multiple of this.
+#define MOTION_WIDTH 8
+
+//One lane is, in integers (see fixedpoint.h):
+//  u    = clamp(value - low, 0, high - low) * scale >> FIX_SHIFT
+//  f    = (linear*u + square*u^2 + cube*u^3) >> FIX_SHIFT,
+//         times extreme if u >= FIX_KNEE
+//  f    = FIX_ONE if value >= high, else 0 if value <= low
+//  rest = rest + f*speed; dist = restPixels(rest); rest -= dist << REST_SHIFT
+//The vector kernels do exactly the same integer operations, so they give the
+//same result as the scalar one, bit for bit.
+
+static void motionScalar(MotionBatch::Lanes &l, int count) {
+    for (int i = 0; i < count; ++i) {
+        const int32_t x = l.value[i];
+        const int32_t u = fixUnit(x, l.low[i], l.high[i], l.scale[i]);
+        const int32_t u2 = (u * u) >> FIX_SHIFT;
+        const int32_t u3 = (u2 * u) >> FIX_SHIFT;
+        int32_t f = (l.linear[i] * u + l.square[i] * u2 + l.cube[i] * u3) >> FIX_SHIFT;
+        if (u >= FIX_KNEE) f = (f * l.extreme[i]) >> FIX_SHIFT;
+        if (x >= l.high[i]) f = FIX_ONE;
+        else if (x <= l.low[i]) f = 0;
+        const int32_t rest = l.rest[i] + f * l.speed[i];
+        const int32_t dist = restPixels(rest);
+        l.rest[i] = rest - dist * (1 << REST_SHIFT);
+        l.dist[i] = dist;
+    }
+}
+
+#ifdef QJOYPAD_MOTION_X86
+//SSE2 has no 32 bit multiply, min or max, so they are made of what it has
+__attribute__((target("sse2")))
+static inline __m128i mullo32(__m128i a, __m128i b) {
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i select32(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+__attribute__((target("sse2")))
+static void motionSse2(MotionBatch::Lanes &l, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(FIX_ONE);
+    const __m128i knee = _mm_set1_epi32(FIX_KNEE - 1);
+    const __m128i restMask = _mm_set1_epi32(REST_MASK);
+    for (int i = 0; i < count; i += 4) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.value[i]));
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.low[i]));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.high[i]));
+        __m128i range = _mm_sub_epi32(high, low);
+        range = _mm_and_si128(_mm_cmpgt_epi32(range, zero), range);
+        __m128i d = _mm_sub_epi32(x, low);
+        d = _mm_and_si128(_mm_cmpgt_epi32(d, zero), d);
+        d = select32(_mm_cmpgt_epi32(d, range), range, d);
+        const __m128i u = _mm_srai_epi32(
+            mullo32(d, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.scale[i]))), FIX_SHIFT);
+        const __m128i u2 = _mm_srai_epi32(mullo32(u, u), FIX_SHIFT);
+        const __m128i u3 = _mm_srai_epi32(mullo32(u2, u), FIX_SHIFT);
+        __m128i f = _mm_add_epi32(
+            _mm_add_epi32(mullo32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.linear[i])), u),
+                          mullo32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.square[i])), u2)),
+            mullo32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.cube[i])), u3));
+        f = _mm_srai_epi32(f, FIX_SHIFT);
+        f = select32(_mm_cmpgt_epi32(u, knee),
+                     _mm_srai_epi32(mullo32(f, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.extreme[i]))), FIX_SHIFT),
+                     f);
+        //x <= low is !(x > low), x >= high is !(high > x)
+        f = _mm_and_si128(_mm_cmpgt_epi32(x, low), f);
+        f = select32(_mm_cmpgt_epi32(high, x), f, one);
+        const __m128i rest = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.rest[i])),
+                                           mullo32(f, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&l.speed[i]))));
+        const __m128i dist = _mm_srai_epi32(
+            _mm_add_epi32(rest, _mm_and_si128(_mm_srai_epi32(rest, 31), restMask)), REST_SHIFT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&l.rest[i]),
+                         _mm_sub_epi32(rest, _mm_slli_epi32(dist, REST_SHIFT)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&l.dist[i]), dist);
+    }
+}
+
+__attribute__((target("avx2")))
+static void motionAvx2(MotionBatch::Lanes &l, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(FIX_ONE);
+    const __m256i knee = _mm256_set1_epi32(FIX_KNEE - 1);
+    const __m256i restMask = _mm256_set1_epi32(REST_MASK);
+    for (int i = 0; i < count; i += 8) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.value[i]));
+        const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.low[i]));
+        const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.high[i]));
+        const __m256i range = _mm256_max_epi32(_mm256_sub_epi32(high, low), zero);
+        const __m256i d = _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(x, low), zero), range);
+        const __m256i u = _mm256_srai_epi32(
+            _mm256_mullo_epi32(d, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.scale[i]))), FIX_SHIFT);
+        const __m256i u2 = _mm256_srai_epi32(_mm256_mullo_epi32(u, u), FIX_SHIFT);
+        const __m256i u3 = _mm256_srai_epi32(_mm256_mullo_epi32(u2, u), FIX_SHIFT);
+        __m256i f = _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.linear[i])), u),
+                             _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.square[i])), u2)),
+            _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.cube[i])), u3));
+        f = _mm256_srai_epi32(f, FIX_SHIFT);
+        f = _mm256_blendv_epi8(f,
+                               _mm256_srai_epi32(_mm256_mullo_epi32(f, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.extreme[i]))), FIX_SHIFT),
+                               _mm256_cmpgt_epi32(u, knee));
+        f = _mm256_and_si256(_mm256_cmpgt_epi32(x, low), f);
+        f = _mm256_blendv_epi8(one, f, _mm256_cmpgt_epi32(high, x));
+        const __m256i rest = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.rest[i])),
+                                              _mm256_mullo_epi32(f, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&l.speed[i]))));
+        const __m256i dist = _mm256_srai_epi32(
+            _mm256_add_epi32(rest, _mm256_and_si256(_mm256_srai_epi32(rest, 31), restMask)), REST_SHIFT);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&l.rest[i]),
+                            _mm256_sub_epi32(rest, _mm256_slli_epi32(dist, REST_SHIFT)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&l.dist[i]), dist);
+    }
+}
+#endif
+
+//the lane formula in int64, with none of the tricks of the kernels. A lane
+//whose movement doesn't fit in 32 bits can't be right in any kernel, it gets
+//a dist no kernel gives.
+static void motionReference(MotionBatch::Lanes &l, int count) {
+    for (int i = 0; i < count; ++i) {
+        const int64_t x = l.value[i];
+        const int64_t low = l.low[i];
+        const int64_t high = l.high[i];
+        const int64_t range = (high > low) ? high - low : 0;
+        int64_t d = x - low;
+        if (d < 0) d = 0;
+        if (d > range) d = range;
+        const int64_t u = (d * l.scale[i]) >> FIX_SHIFT;
+        const int64_t u2 = (u * u) >> FIX_SHIFT;
+        const int64_t u3 = (u2 * u) >> FIX_SHIFT;
+        int64_t f = (l.linear[i] * u + l.square[i] * u2 + l.cube[i] * u3) >> FIX_SHIFT;
+        if (u >= FIX_KNEE) f = (f * l.extreme[i]) >> FIX_SHIFT;
+        if (x >= high) f = FIX_ONE;
+        else if (x <= low) f = 0;
+        const int64_t rest = l.rest[i] + f * l.speed[i];
+        if (rest > INT32_MAX || rest < INT32_MIN) {
+            l.dist[i] = INT32_MIN;
+            continue;
+        }
+        //rounds towards 0, like restPixels()
+        const int64_t dist = rest / (1 << REST_SHIFT);
+        l.rest[i] = int32_t(rest - dist * (1 << REST_SHIFT));
+        l.dist[i] = int32_t(dist);
+    }
+}
+
+static const char *motionKernelName = "scalar";
+
+static MotionBatch::Kernel pickKernel() {
+#ifdef QJOYPAD_MOTION_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        motionKernelName = "avx2";
+        return &motionAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        motionKernelName = "sse2";
+        return &motionSse2;
+    }
+#endif
+    motionKernelName = "scalar";
+    return &motionScalar;
+}
+
+MotionBatch::MotionBatch() {
+    active = 0;
+    used = 0;
+    extraX = 0.0F;
+    extraY = 0.0F;
+    kernel = pickKernel();
+}
+
+MotionBatch &MotionBatch::instance() {
+    static MotionBatch batch;
+    return batch;
+}
+
+const char *MotionBatch::kernelName() {
+    instance();
+    return motionKernelName;
+}
+
+void MotionBatch::resize(Lanes &lanes, int size) {
+    std::vector<int32_t> *fields[] = {
+        &lanes.value, &lanes.low, &lanes.high, &lanes.scale, &lanes.linear,
+        &lanes.square, &lanes.cube, &lanes.extreme, &lanes.speed, &lanes.rest,
+        &lanes.dist
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+        fields[i]->resize(size, 0);
+    }
+}
+
+void MotionBatch::grow() {
+    const size_t size = dirX.size() + MOTION_WIDTH;
+    resize(lanes, int(size));
+    dirX.resize(size, 0);
+    dirY.resize(size, 0);
+}
+
+void MotionBatch::clearLane(int i) {
+    lanes.value[i] = 0;
+    lanes.low[i] = 0;
+    lanes.high[i] = 0;
+    lanes.scale[i] = 0;
+    lanes.linear[i] = 0;
+    lanes.square[i] = 0;
+    lanes.cube[i] = 0;
+    lanes.extreme[i] = FIX_ONE;
+    lanes.speed[i] = 0;
+    lanes.rest[i] = 0;
+    lanes.dist[i] = 0;
+    dirX[i] = 0;
+    dirY[i] = 0;
+}
+
+int MotionBatch::acquire(int dx, int dy, int32_t rest) {
+    int i;
+    if (!freeLanes.empty()) {
+        i = freeLanes.back();
+        freeLanes.pop_back();
+    }
+    else {
+        if (used == int(dirX.size())) grow();
+        i = used++;
+    }
+    if (active++ == 0 && !isScheduled()) {
+        //start ticking
+        Scheduler::instance().schedule(this, Scheduler::instance().now() + MSEC);
+    }
+    clearLane(i);
+    lanes.rest[i] = rest;
+    dirX[i] = dx;
+    dirY[i] = dy;
+    return i;
+}
+
+int32_t MotionBatch::releaseLane(int i) {
+    const int32_t rest = lanes.rest[i];
+    clearLane(i);
+    if (-- active == 0) {
+        //start packing lanes from the front again
+        freeLanes.clear();
+        used = 0;
+        Scheduler::instance().cancel(this);
+    }
+    else {
+        freeLanes.push_back(i);
+    }
+    return rest;
+}
+
+void MotionBatch::set(int i, const AxisData &axis) {
+    const int speed = axis.maxSpeed << SPEED_SHIFT;
+    set(i, abs(axis.state), axis.dZone, axis.xZone, axis.inverseRange,
+        axis.transferCurve, axis.exponent, (axis.state < 0) ? -speed : speed);
+}
+
+void MotionBatch::set(int i, int magnitude, int dZone, int xZone, int32_t scale,
+                      AxisEnums::TransferCurve curve, int64_t exponent, int speed) {
+    setLane(lanes, i, magnitude, dZone, xZone, scale, curve, exponent, speed);
+}
+
+void MotionBatch::setLane(Lanes &lanes, int i, int magnitude, int dZone, int xZone,
+                          int32_t scale, AxisEnums::TransferCurve curve, int64_t exponent,
+                          int speed) {
+    lanes.value[i] = magnitude;
+    lanes.low[i] = dZone;
+    lanes.high[i] = xZone;
+    lanes.scale[i] = scale;
+    lanes.linear[i] = 0;
+    lanes.square[i] = 0;
+    lanes.cube[i] = 0;
+    lanes.extreme[i] = FIX_ONE;
+
+    switch (curve) {
+    case AxisEnums::Linear: lanes.linear[i] = FIX_ONE; break;
+    case AxisEnums::Quadratic: lanes.square[i] = FIX_ONE; break;
+    case AxisEnums::Cubic: lanes.cube[i] = FIX_ONE; break;
+    case AxisEnums::QuadraticExtreme:
+        lanes.square[i] = FIX_ONE;
+        lanes.extreme[i] = FIX_EXTREME;
+        break;
+    case AxisEnums::PowerFunction: {
+        //there is no vector pow, so work the curve out here and pass it on
+        //as a linear one over [0, FIX_ONE]. This only happens on events.
+        int32_t u;
+        if (magnitude >= xZone) u = FIX_ONE;
+        else if (magnitude <= dZone) u = 0;
+        else u = fixPow(fixUnit(magnitude, dZone, xZone, scale), exponent);
+        lanes.value[i] = u;
+        lanes.low[i] = 0;
+        lanes.high[i] = FIX_ONE;
+        lanes.scale[i] = fixScale(0, FIX_ONE);
+        lanes.linear[i] = FIX_ONE;
+        break;
+    }
+    }
+
+    lanes.speed[i] = speed;
+}
+
+void MotionBatch::fire(int64_t now) {
+    statAdd(Stats::instance().motionTicks);
+    run();
+    if (active == 0) return;
+    //keep to the grid of the first tick, unless we fell behind
+    int64_t next = when() + MSEC;
+    if (next <= now) next = now + MSEC;
+    Scheduler::instance().schedule(this, next);
+}
+
+void MotionBatch::add(float x, float y) {
+    extraX += x;
+    extraY += y;
+    if (!isScheduled()) {
+        Scheduler::instance().schedule(this, Scheduler::instance().now() + MSEC);
+    }
+}
+
+void MotionBatch::run() {
+    int x = 0, y = 0;
+    if (active > 0) {
+        kernel(lanes, used);
+        for (int i = 0; i < used; ++i) {
+            x += dirX[i] * lanes.dist[i];
+            y += dirY[i] * lanes.dist[i];
+        }
+    }
+    //whole pixels of what was added, the rest waits for more
+    const int ex = int(extraX);
+    const int ey = int(extraY);
+    extraX -= ex;
+    extraY -= ey;
+    x += ex;
+    y += ey;
+
+    if (x == 0 && y == 0) return;
+    FakeEvent e;
+    e.type = FakeEvent::MouseMove;
+    e.move.x = x;
+    e.move.y = y;
+    sendevent(e);
+}
+
+std::vector<MotionBatch::KernelCheck> MotionBatch::checkKernels(int ticks) {
+    std::vector<const char*> names;
+    std::vector<Kernel> kernels;
+    names.push_back("scalar");
+    kernels.push_back(&motionScalar);
+#ifdef QJOYPAD_MOTION_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        names.push_back("sse2");
+        kernels.push_back(&motionSse2);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        names.push_back("avx2");
+        kernels.push_back(&motionAvx2);
+    }
+#endif
+    std::vector<KernelCheck> checks(kernels.size());
+    for (size_t k = 0; k < kernels.size(); ++k) {
+        checks[k].name = names[k];
+        checks[k].mismatches = 0;
+    }
+
+    //the last lanes are the int64 version
+    const int count = 8 * MOTION_WIDTH;
+    std::vector<Lanes> lanes(kernels.size() + 1);
+    for (size_t k = 0; k < lanes.size(); ++k) resize(lanes[k], count);
+    Lanes &reference = lanes.back();
+    std::vector<int> values(count, 0);
+    uint64_t seed = 1;
+
+    for (int t = 0; t < ticks; ++t) {
+        //the axes move every few ticks, the rest carries over in between
+        if (t % 8 == 0) {
+            for (int i = 0; i < count; ++i) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                values[i] += int((seed >> 33) % 4001) - 2000;
+                if (values[i] > JOYMAX) values[i] = JOYMAX;
+                if (values[i] < JOYMIN) values[i] = JOYMIN;
+
+                const int dZone = (i * 977) % 8000;
+                const int xZone = 20000 + (i * 1331) % (JOYMAX - 20000);
+                const int maxSpeed = (i == 0) ? MAXMOUSESPEED : (i * 37) % MAXMOUSESPEED + 1;
+                const int speed = maxSpeed << SPEED_SHIFT;
+                for (size_t k = 0; k < lanes.size(); ++k) {
+                    setLane(lanes[k], i, abs(values[i]), dZone, xZone, fixScale(dZone, xZone),
+                            AxisEnums::TransferCurve(i % (AxisEnums::PowerFunction + 1)),
+                            fixExponent(0.3F + i * 0.1F), (values[i] < 0) ? -speed : speed);
+                }
+            }
+        }
+        motionReference(reference, count);
+        for (size_t k = 0; k < kernels.size(); ++k) {
+            kernels[k](lanes[k], count);
+            for (int i = 0; i < count; ++i) {
+                if (lanes[k].dist[i] != reference.dist[i] || lanes[k].rest[i] != reference.rest[i]) {
+                    ++ checks[k].mismatches;
+                    //go on from the right state
+                    lanes[k].rest[i] = reference.rest[i];
+                }
+            }
+        }
+    }
+    return checks;
+}
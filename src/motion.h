@@ -0,0 +1,109 @@
+#ifndef QJOYPAD_MOTION_H
+#define QJOYPAD_MOTION_H
+
+#include <vector>
+
+#include "axisdata.h"
+#include "scheduler.h"
+#include "fixedpoint.h"
+
+//The mouse movement of all gradient mouse axes of all devices. Every such
+//axis that is pushed out of its dead zone holds a lane here. Every tick the
+//movement of all lanes is worked out at once, with the widest vector
+//instructions the CPU has, and the sum is sent as one mouse movement. The
+//lanes are in fixed point (fixedpoint.h), so every kernel gives the same
+//pixels. The
+//batch ticks through the Scheduler, and only while it has lanes in use or
+//movement from add() to send: with every axis and stick centered and the pad
+//lying still nothing wakes up at all.
+class MotionBatch : public Scheduler::Entry {
+    public:
+        MotionBatch();
+        //the batch shared by all devices
+        static MotionBatch &instance();
+        //get a lane for an axis that starts moving the mouse. dirX and dirY
+        //say where a positive axis value moves the mouse (-1, 0 or 1), rest
+        //is the sub-pixel movement left over from the last time.
+        int acquire(int dirX, int dirY, int32_t rest);
+        //copy the state and settings of an axis into its lane. Call whenever
+        //either of them changes.
+        void set(int lane, const AxisData &axis);
+        //the same for anything else that has a transfer curve: magnitude is
+        //how far it is pushed, scale and exponent are fixScale() of the
+        //zones and fixExponent() of the sensitivity, speed is the signed
+        //maximum speed of this lane in 1/8 pixel.
+        void set(int lane, int magnitude, int dZone, int xZone, int32_t scale,
+                 AxisEnums::TransferCurve curve, int64_t exponent, int speed);
+        //the axis stopped moving the mouse. Returns the sub-pixel movement
+        //that is left.
+        int32_t releaseLane(int lane);
+        //true iff there are lanes to run
+        bool isActive() const { return active > 0; }
+        //movement that doesn't come from a lane, like that of a gyro. It goes
+        //out with the next tick, together with the lanes.
+        void add(float x, float y);
+        //move the mouse by all lanes for one tick
+        void run();
+        //a tick is due, run() and schedule the next one
+        void fire(int64_t now);
+        //the name of the kernel picked for this CPU
+        static const char *kernelName();
+
+        //how many lane results of a kernel were not what a plain int64
+        //version of the lane formula gives, see checkKernels()
+        struct KernelCheck {
+            const char *name;
+            long mismatches;
+        };
+        //run every kernel this CPU can run and the int64 version on the same
+        //lanes, with every curve, for ticks ticks of axes moving at random
+        static std::vector<KernelCheck> checkKernels(int ticks);
+
+        //the lanes in structure of arrays form, so the kernel can load one
+        //field of several lanes at once. The arrays are padded to a multiple
+        //of the widest vector. Free lanes have a speed of 0, they are computed
+        //but never move the mouse.
+        struct Lanes {
+            //how far the axis is pushed, and where the curve starts and ends
+            std::vector<int32_t> value;
+            std::vector<int32_t> low;
+            std::vector<int32_t> high;
+            std::vector<int32_t> scale;
+            //weights of u, u^2 and u^3 for the transfer curve, in 1/FIX_ONE
+            std::vector<int32_t> linear;
+            std::vector<int32_t> square;
+            std::vector<int32_t> cube;
+            //factor applied from u >= FIX_KNEE on (QuadraticExtreme)
+            std::vector<int32_t> extreme;
+            //maxSpeed in 1/8 pixel, with the sign of the axis value
+            std::vector<int32_t> speed;
+            //the sub-pixel movement carried over from earlier ticks
+            std::vector<int32_t> rest;
+            //the output: whole pixels to move
+            std::vector<int32_t> dist;
+        };
+        typedef void (*Kernel)(Lanes &lanes, int count);
+
+    private:
+        void grow();
+        void clearLane(int lane);
+        //what set() does, on any lanes
+        static void setLane(Lanes &lanes, int lane, int magnitude, int dZone, int xZone,
+                            int32_t scale, AxisEnums::TransferCurve curve, int64_t exponent,
+                            int speed);
+        static void resize(Lanes &lanes, int size);
+
+        Lanes lanes;
+        std::vector<int> dirX;
+        std::vector<int> dirY;
+        std::vector<int> freeLanes;
+        //lanes in use, and the number of lanes the kernel has to look at
+        int active;
+        int used;
+        //what add() left for the next tick, in pixels
+        float extraX;
+        float extraY;
+        Kernel kernel;
+};
+
+#endif
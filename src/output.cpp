@@ -0,0 +1,140 @@
+#include <QX11Info>
+
+#include "output.h"
+#include "stats.h"
+#include "error.h"
+
+static OutputThread *runningOutput = 0;
+
+OutputThread::OutputThread()
+    : display(0), head(0), tail(0), pending(0), stopping(false), flushPosted(false),
+      overflowing(false) {
+}
+
+OutputThread::~OutputThread() {
+    close();
+}
+
+OutputThread *OutputThread::instance() {
+    return runningOutput;
+}
+
+bool OutputThread::open() {
+    if (display) return true;
+    //the same X server as the GUI, on a connection of our own
+    display = XOpenDisplay(DisplayString(QX11Info::display()));
+    if (!display) {
+        debug_mesg("couldn't open a display for the output thread, sending on the GUI's\n");
+        return false;
+    }
+    stopping.store(false, std::memory_order_relaxed);
+    start();
+    runningOutput = this;
+    return true;
+}
+
+void OutputThread::close() {
+    if (!display) return;
+    runningOutput = 0;
+    //nothing else is left to do, so here it's fine to wait for the X server
+    while (!overflow.empty()) {
+        drainOverflow();
+        yieldCurrentThread();
+    }
+    flush();
+    stopping.store(true, std::memory_order_release);
+    batches.release();
+    wait();
+    XCloseDisplay(display);
+    display = 0;
+}
+
+void OutputThread::push(const FakeEvent &e) {
+    //once something waits in the overflow, everything after it has to wait
+    //as well, or the order would change
+    if (!overflow.empty()) drainOverflow();
+    if (!overflow.empty() || pending - head.load(std::memory_order_acquire) >= OUTPUT_QUEUE_SIZE) {
+        park(e);
+        return;
+    }
+    queue[pending & (OUTPUT_QUEUE_SIZE - 1)] = e;
+    ++ pending;
+    if (!flushPosted) {
+        //flush when we're back in the event loop, unless someone does sooner
+        flushPosted = true;
+        QMetaObject::invokeMethod(this, "postedFlush", Qt::QueuedConnection);
+    }
+}
+
+void OutputThread::park(const FakeEvent &e) {
+    //the X server isn't keeping up. Relative movement adds up and only the
+    //last absolute position matters, so those are merged.
+    if (!overflow.empty()) {
+        FakeEvent &last = overflow.back();
+        if (e.type == FakeEvent::MouseMove && last.type == FakeEvent::MouseMove) {
+            last.move.x += e.move.x;
+            last.move.y += e.move.y;
+            return;
+        }
+        if (e.type == FakeEvent::MouseMoveAbsolute && last.type == FakeEvent::MouseMoveAbsolute) {
+            last = e;
+            return;
+        }
+    }
+    if (overflow.size() >= OUTPUT_OVERFLOW_SIZE) {
+        statAdd(Stats::instance().outputDropped);
+        return;
+    }
+    overflow.push_back(e);
+    statMax(Stats::instance().outputOverflowMax, uint32_t(overflow.size()));
+    overflowing.store(true, std::memory_order_release);
+}
+
+void OutputThread::drainOverflow() {
+    while (!overflow.empty() &&
+           pending - head.load(std::memory_order_acquire) < OUTPUT_QUEUE_SIZE) {
+        queue[pending & (OUTPUT_QUEUE_SIZE - 1)] = overflow.front();
+        overflow.pop_front();
+        ++ pending;
+    }
+    if (overflow.empty()) overflowing.store(false, std::memory_order_release);
+    flush();
+}
+
+void OutputThread::flush() {
+    if (pending == tail.load(std::memory_order_relaxed)) return;
+    statMax(Stats::instance().outputQueueMax,
+            pending - head.load(std::memory_order_relaxed));
+    tail.store(pending, std::memory_order_release);
+    batches.release();
+}
+
+void OutputThread::postedFlush() {
+    flushPosted = false;
+    flush();
+}
+
+void OutputThread::run() {
+    for (;;) {
+        batches.acquire();
+        //everything handed over so far goes out together
+        batches.tryAcquire(batches.available());
+        //read before the tail, so the last batch is sent before stopping
+        const bool last = stopping.load(std::memory_order_acquire);
+        uint32_t from = head.load(std::memory_order_relaxed);
+        const uint32_t to = tail.load(std::memory_order_acquire);
+        if (from != to) {
+            for (; from != to; ++ from) {
+                xtestevent(display, queue[from & (OUTPUT_QUEUE_SIZE - 1)]);
+            }
+            head.store(to, std::memory_order_release);
+            XFlush(display);
+            statAdd(Stats::instance().flushes);
+            //there is room again for what waits on the GUI thread
+            if (overflowing.load(std::memory_order_acquire)) {
+                QMetaObject::invokeMethod(this, "drainOverflow", Qt::QueuedConnection);
+            }
+        }
+        if (last) break;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef QJOYPAD_OUTPUT_H
+#define QJOYPAD_OUTPUT_H
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+
+#include <QThread>
+#include <QSemaphore>
+
+#include "constant.h"
+#include "event.h"
+
+//Sends the fake events on a connection to the X server of its own, so the
+//XTest requests don't queue up behind Qt's and a slow X server never holds
+//up reading the devices or the tray icon.
+//
+//Events go through a single producer, single consumer queue. sendevent()
+//adds them on the GUI thread, flush() hands everything added since the last
+//flush to the thread as one batch, and the thread sends each batch with one
+//XFlush. Anything added without an explicit flush is flushed once the GUI
+//thread gets back to its event loop.
+//
+//The GUI thread never waits for the X server. When the queue is full,
+//events wait in an overflow list of the GUI thread's own, and go into the
+//queue as the thread makes room. Mouse movement in the overflow is merged
+//into the movement before it, so only presses and releases pile up. Only
+//once OUTPUT_OVERFLOW_SIZE of those wait, the X server has been stuck for
+//long enough that new events are dropped and counted instead.
+class OutputThread : public QThread {
+    Q_OBJECT
+    public:
+        OutputThread();
+        ~OutputThread();
+        //the running output thread, or 0 if events are sent right away
+        static OutputThread *instance();
+
+        //open the display and start sending. Returns false if the display
+        //couldn't be opened, then everything stays on the GUI's display.
+        bool open();
+        //send what is left and stop
+        void close();
+        //queue e to be sent with the next batch
+        void push(const FakeEvent &e);
+    public slots:
+        //hand the queued events to the thread
+        void flush();
+    private slots:
+        void postedFlush();
+        //move what fits from the overflow to the queue and flush
+        void drainOverflow();
+    protected:
+        void run();
+    private:
+        //keep e in the overflow
+        void park(const FakeEvent &e);
+        Display *display;
+        FakeEvent queue[OUTPUT_QUEUE_SIZE];
+        //head is where the thread reads, tail how far the batches that were
+        //handed over go. pending is where the GUI thread writes next.
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+        uint32_t pending;
+        //one for every batch handed over
+        QSemaphore batches;
+        std::atomic<bool> stopping;
+        bool flushPosted;
+        //events that didn't fit in the queue, only touched by the GUI
+        //thread. overflowing tells the thread to ask for them once it has
+        //sent a batch.
+        std::deque<FakeEvent> overflow;
+        std::atomic<bool> overflowing;
+};
+
+#endif
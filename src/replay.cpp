@@ -0,0 +1,235 @@
+//qjoypad-replay: run recorded joystick input through a layout on a virtual
+//clock and print what QJoyPad would have sent. A recording is simply what
+//the joystick device gives, as in `cat /dev/input/js0 > recording`. The
+//output only depends on the layout and the recording, so two runs give the
+//same bytes, and hours of input take seconds.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <linux/joystick.h>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+#include "joypad.h"
+#include "event.h"
+#include "screen.h"
+#include "scheduler.h"
+
+//prints every event with the time it was sent at
+class PrintSink : public EventSink {
+    public:
+        PrintSink(FILE *out) : out(out), count(0) {}
+        void event(const FakeEvent &e) {
+            const long long time = (long long)Scheduler::instance().now();
+            switch (e.type) {
+            case FakeEvent::KeyUp:
+                fprintf(out, "%lld keyup %d\n", time, e.keycode);
+                break;
+            case FakeEvent::KeyDown:
+                fprintf(out, "%lld keydown %d\n", time, e.keycode);
+                break;
+            case FakeEvent::MouseUp:
+                fprintf(out, "%lld buttonup %d\n", time, e.keycode);
+                break;
+            case FakeEvent::MouseDown:
+                fprintf(out, "%lld buttondown %d\n", time, e.keycode);
+                break;
+            case FakeEvent::MouseMove:
+                fprintf(out, "%lld move %d %d\n", time, e.move.x, e.move.y);
+                break;
+            case FakeEvent::MouseMoveAbsolute:
+                fprintf(out, "%lld moveto %d %d\n", time, e.move.x, e.move.y);
+                break;
+            }
+            ++ count;
+        }
+
+        FILE *out;
+        long count;
+};
+
+//read the definition of joystick number from a layout file into joypad
+static bool readLayout(const QString &path, int number, JoyPad *joypad) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "%s: cannot read the layout\n", qPrintable(path));
+        return false;
+    }
+    QTextStream stream(&file);
+    QString word;
+    QChar ch = 0;
+    bool found = false;
+    while (!stream.atEnd()) {
+        stream >> word;
+        if (word.isNull()) break;
+        if (word.startsWith('#')) {
+            stream.readLine();
+            continue;
+        }
+        bool okay = false;
+        int num = 0;
+        if (word.compare(QLatin1String("joystick"), Qt::CaseInsensitive) == 0) {
+            stream >> word;
+            num = word.toInt(&okay);
+        }
+        stream.skipWhiteSpace();
+        stream >> ch;
+        if (!okay || num < 1 || ch != QChar('{')) {
+            fprintf(stderr, "%s: not a layout file\n", qPrintable(path));
+            return false;
+        }
+        //the definitions of other joysticks are read and thrown away
+        JoyPad other(num - 1, -1, 0);
+        if (!((num == number) ? joypad : &other)->readConfig(stream)) return false;
+        found = found || num == number;
+    }
+    if (!found) {
+        fprintf(stderr, "%s: no definition for joystick %d, nothing will happen\n",
+                qPrintable(path), number);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    int number = 1;
+    int width = 1920, height = 1080;
+    int tail = 1000;
+    int checkIdle = 0;
+
+    struct option long_options[] = {
+        {"help",     no_argument,       0, 'h'},
+        {"joystick", required_argument, 0, 'j'},
+        {"screen",   required_argument, 0, 's'},
+        {"tail",     required_argument, 0, 't'},
+        {"check-idle", required_argument, 0, 'i'},
+        {0,          0,                 0,  0 }
+    };
+
+    for (;;) {
+        int c = getopt_long(argc, argv, "hj:s:t:i:", long_options, NULL);
+        if (c == -1) break;
+
+        switch (c) {
+            case 'h':
+                printf("Usage: %s [--joystick=N] [--screen=WxH] [--tail=MS] [--check-idle=MS]\n"
+                       "       LAYOUT RECORDING\n"
+                       "\n"
+                       "Run RECORDING, the raw events of a joystick device, through the\n"
+                       "definition of joystick N (default 1) in the layout file LAYOUT,\n"
+                       "and print every event QJoyPad would send, with the time in ms.\n"
+                       "\n"
+                       "Options:\n"
+                       "  -h, --help            Print this help message.\n"
+                       "  -j, --joystick=N      Use the definition of joystick N.\n"
+                       "  -s, --screen=WxH      The size of the screen absolute axes map\n"
+                       "                        to (default 1920x1080).\n"
+                       "  -t, --tail=MS         Keep the clock running this long after\n"
+                       "                        the last event (default 1000), then\n"
+                       "                        release everything.\n"
+                       "  -i, --check-idle=MS   After the tail, keep the clock running this\n"
+                       "                        much longer (at least 2000), and fail if\n"
+                       "                        anything still wakes up in that time. The\n"
+                       "                        recording has to end with every control\n"
+                       "                        let go.\n", argv[0]);
+                return 0;
+
+            case 'j':
+                number = atoi(optarg);
+                break;
+
+            case 's':
+                if (sscanf(optarg, "%dx%d", &width, &height) != 2 || width < 1 || height < 1) {
+                    fprintf(stderr, "Not a screen size: %s\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case 't':
+                tail = atoi(optarg);
+                break;
+
+            case 'i':
+                checkIdle = atoi(optarg);
+                //the wakeup rate only drops to 0 after two quiet seconds
+                if (checkIdle < 2000) {
+                    fprintf(stderr, "--check-idle needs at least 2000 ms: %s\n", optarg);
+                    return 1;
+                }
+                break;
+
+            default:
+                fprintf(stderr, "See `%s --help` for more information\n", argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind != 2 || number < 1) {
+        fprintf(stderr, "See `%s --help` for more information\n", argv[0]);
+        return 1;
+    }
+
+    //everything is timed by the recording, and nothing goes to X
+    VirtualClock clock;
+    Scheduler &scheduler = Scheduler::instance();
+    scheduler.setClock(&clock);
+    PrintSink sink(stdout);
+    setEventSink(&sink);
+    setScreenSize(width, height);
+
+    JoyPad joypad(number - 1, -1, 0);
+    if (!readLayout(argv[optind], number, &joypad)) return 1;
+
+    QFile file(argv[optind + 1]);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "%s: cannot read the recording\n", argv[optind + 1]);
+        return 1;
+    }
+    const QByteArray data = file.readAll();
+    const int count = data.size() / sizeof(js_event);
+    if (data.size() % sizeof(js_event) != 0) {
+        //most likely cut off while recording, the rest is still good
+        fprintf(stderr, "%s: ignoring %d bytes at the end that aren't a whole event\n",
+                argv[optind + 1], int(data.size() % sizeof(js_event)));
+    }
+    QVector<js_event> events(count);
+    memcpy(events.data(), data.constData(), count * sizeof(js_event));
+
+    //events with the same time were most likely read in one go, so they
+    //are handled as one batch. js_event.time wraps after 49 days, the clock
+    //keeps counting.
+    int64_t time = 0;
+    uint32_t last = count > 0 ? events[0].time : 0;
+    for (int i = 0; i < count; ) {
+        int n = 1;
+        while (i + n < count && events[i + n].time == events[i].time) ++ n;
+        time += uint32_t(events[i].time - last);
+        last = events[i].time;
+        scheduler.runUntil(&clock, time);
+        joypad.replay(&events[i], n);
+        i += n;
+    }
+    scheduler.runUntil(&clock, time + tail);
+
+    //with every control let go, filters, pwm, rapidfire and macros must all
+    //have stopped, and nothing may wake the scheduler up anymore
+    bool idle = true;
+    if (checkIdle > 0) {
+        const uint64_t wakeups = scheduler.wakeups();
+        scheduler.runUntil(&clock, time + tail + checkIdle);
+        const uint64_t more = scheduler.wakeups() - wakeups;
+        if (more > 0 || scheduler.wakeupsPerSecond() != 0) {
+            fprintf(stderr, "not idle: %llu wakeups from %lld ms to %lld ms, %d in the last second\n",
+                    (unsigned long long)more, (long long)(time + tail),
+                    (long long)(time + tail + checkIdle), scheduler.wakeupsPerSecond());
+            idle = false;
+        }
+    }
+    joypad.release();
+
+    fprintf(stderr, "%d events in, %ld out, %lld ms\n", count, sink.count, (long long)time);
+    return idle ? 0 : 2;
+}
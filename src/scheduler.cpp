@@ -0,0 +1,177 @@
+#include <time.h>
+
+#include "scheduler.h"
+#include "stats.h"
+
+//entries are never allocated during playback, the heap only grows past this
+//if this many things are ever scheduled at once.
+#define SCHEDULER_RESERVE 64
+
+int64_t MonotonicClock::now() const {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+static MonotonicClock monotonicClock;
+
+Scheduler::Entry::~Entry() {
+    //the heap must not keep a pointer to it
+    if (slot >= 0) Scheduler::instance().cancel(this);
+}
+
+Scheduler::Scheduler() {
+    heap.reserve(SCHEDULER_RESERVE);
+    clock = &monotonicClock;
+    waker = 0;
+    armed = -1;
+    running = false;
+    wakeupCount = 0;
+    rateStart = clock->now();
+    rateCount = 0;
+    lastRate = 0;
+}
+
+Scheduler::~Scheduler() {
+    //entries that outlive the scheduler, like other statics at exit, must
+    //not try to take themselves out of it
+    for (size_t i = 0; i < heap.size(); ++i) heap[i]->slot = -1;
+}
+
+Scheduler &Scheduler::instance() {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+void Scheduler::setClock(Clock *clock) {
+    this->clock = clock ? clock : &monotonicClock;
+    //the rate is measured on the new clock from now on
+    rateStart = this->clock->now();
+    rateCount = 0;
+    lastRate = 0;
+}
+
+void Scheduler::setWaker(Waker *waker) {
+    this->waker = waker;
+    armed = -1;
+    rearm();
+}
+
+void Scheduler::swap(int a, int b) {
+    Entry *entry = heap[a];
+    heap[a] = heap[b];
+    heap[b] = entry;
+    heap[a]->slot = a;
+    heap[b]->slot = b;
+}
+
+void Scheduler::up(int slot) {
+    while (slot > 0) {
+        const int parent = (slot - 1) / 2;
+        if (heap[parent]->deadline <= heap[slot]->deadline) break;
+        swap(parent, slot);
+        slot = parent;
+    }
+}
+
+void Scheduler::down(int slot) {
+    const int size = int(heap.size());
+    for (;;) {
+        int least = slot;
+        const int left = slot * 2 + 1;
+        const int right = left + 1;
+        if (left < size && heap[left]->deadline < heap[least]->deadline) least = left;
+        if (right < size && heap[right]->deadline < heap[least]->deadline) least = right;
+        if (least == slot) break;
+        swap(slot, least);
+        slot = least;
+    }
+}
+
+void Scheduler::remove(int slot) {
+    Entry *entry = heap[slot];
+    const int last = int(heap.size()) - 1;
+    if (slot != last) {
+        swap(slot, last);
+    }
+    heap.pop_back();
+    entry->slot = -1;
+    if (slot < last) {
+        up(slot);
+        down(slot);
+    }
+}
+
+void Scheduler::schedule(Entry *entry, int64_t deadline) {
+    if (entry->slot >= 0) {
+        entry->deadline = deadline;
+        up(entry->slot);
+        down(entry->slot);
+    }
+    else {
+        entry->deadline = deadline;
+        entry->slot = int(heap.size());
+        heap.push_back(entry);
+        up(entry->slot);
+    }
+    rearm();
+}
+
+void Scheduler::cancel(Entry *entry) {
+    if (entry->slot < 0) return;
+    remove(entry->slot);
+    rearm();
+}
+
+int64_t Scheduler::nextDeadline() const {
+    return heap.empty() ? -1 : heap[0]->deadline;
+}
+
+void Scheduler::rearm() {
+    //runDue() rearms once it is done
+    if (running || !waker) return;
+    const int64_t next = nextDeadline();
+    if (next != armed) {
+        armed = next;
+        waker->wakeAt(next);
+    }
+}
+
+int Scheduler::wakeupsPerSecond() const {
+    const int64_t elapsed = now() - rateStart;
+    if (elapsed >= 2000) return 0;
+    if (elapsed >= 1000) return rateCount;
+    return lastRate;
+}
+
+void Scheduler::runDue() {
+    running = true;
+    //the waker is not armed anymore when it calls this
+    armed = -1;
+    const int64_t time = now();
+    ++ wakeupCount;
+    if (time - rateStart >= 1000) {
+        //a second without any wakeups in between counts as 0
+        lastRate = (time - rateStart < 2000) ? rateCount : 0;
+        rateStart = time;
+        rateCount = 0;
+    }
+    ++ rateCount;
+    while (!heap.empty() && heap[0]->deadline <= time) {
+        Entry *entry = heap[0];
+        remove(0);
+        OutputScope scope(entry->outputStats);
+        entry->fire(time);
+    }
+    running = false;
+    rearm();
+}
+
+void Scheduler::runUntil(VirtualClock *clock, int64_t time) {
+    int64_t next;
+    while ((next = nextDeadline()) >= 0 && next <= time) {
+        if (next > clock->now()) clock->set(next);
+        runDue();
+    }
+    if (time > clock->now()) clock->set(time);
+}
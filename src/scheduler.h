@@ -0,0 +1,127 @@
+#ifndef QJOYPAD_SCHEDULER_H
+#define QJOYPAD_SCHEDULER_H
+
+#include <stdint.h>
+#include <vector>
+
+class DeviceStats;
+
+//where the Scheduler gets the time from, in milliseconds. Can be replaced
+//with one that only moves when told to, for replaying input.
+class Clock {
+    public:
+        virtual ~Clock() {}
+        virtual int64_t now() const = 0;
+};
+
+//CLOCK_MONOTONIC
+class MonotonicClock : public Clock {
+    public:
+        int64_t now() const;
+};
+
+//simulated time, that only moves when set(). With this the Scheduler runs
+//hours of recorded input in as much time as it takes to work it out, and
+//does exactly the same thing every time (see Scheduler::runUntil()).
+class VirtualClock : public Clock {
+    public:
+        VirtualClock() : time(0) {}
+        int64_t now() const { return time; }
+        void set(int64_t time) { this->time = time; }
+    private:
+        int64_t time;
+};
+
+//Runs things at absolute points in time, for everything that has to happen
+//later: macros, rapidfire, pwm. Everything shares one wakeup source, set
+//with setWaker(), that is only armed for the earliest deadline.
+class Scheduler {
+    public:
+        //something that can be scheduled. These are owned by whoever schedules
+        //them and must not move while they are scheduled. One that is
+        //destroyed while scheduled is cancelled first. A copy of an entry is
+        //never scheduled, so things that contain one can still be kept in
+        //containers that copy.
+        class Entry {
+            public:
+                Entry() : deadline(0), slot(-1), outputStats(0) {}
+                Entry(const Entry &other)
+                    : deadline(0), slot(-1), outputStats(other.outputStats) {}
+                Entry &operator=(const Entry &other) {
+                    outputStats = other.outputStats;
+                    return *this;
+                }
+                virtual ~Entry();
+                //called once the deadline has passed. now is the time the
+                //scheduler woke up, when() still says when it was due.
+                virtual void fire(int64_t now) = 0;
+                bool isScheduled() const { return slot >= 0; }
+                int64_t when() const { return deadline; }
+                //the device the fake events sent from fire() are counted
+                //for, see OutputScope
+                void setOutputStats(DeviceStats *stats) { outputStats = stats; }
+            private:
+                friend class Scheduler;
+                int64_t deadline;
+                //position in the heap, -1 if not scheduled
+                int slot;
+                DeviceStats *outputStats;
+        };
+
+        //asked to call runDue() at deadline, or to stop waking if it's -1
+        class Waker {
+            public:
+                virtual ~Waker() {}
+                virtual void wakeAt(int64_t deadline) = 0;
+        };
+
+        Scheduler();
+        ~Scheduler();
+        //the scheduler shared by all devices
+        static Scheduler &instance();
+
+        void setClock(Clock *clock);
+        void setWaker(Waker *waker);
+        int64_t now() const { return clock->now(); }
+
+        //run entry at deadline. If it is already scheduled, it's moved.
+        void schedule(Entry *entry, int64_t deadline);
+        void cancel(Entry *entry);
+        //the earliest deadline, or -1 if nothing is scheduled
+        int64_t nextDeadline() const;
+        //fire every entry whose deadline has passed
+        void runDue();
+        //move clock forward to time, firing every entry that comes due on
+        //the way at its deadline, as if the waker had woken right on time.
+        //clock has to be the one the scheduler uses.
+        void runUntil(VirtualClock *clock, int64_t time);
+
+        //how often runDue() was called in total, and in the last full second.
+        //Once everything is idle the rate drops to 0.
+        uint64_t wakeups() const { return wakeupCount; }
+        int wakeupsPerSecond() const;
+
+    private:
+        void swap(int a, int b);
+        void up(int slot);
+        void down(int slot);
+        void remove(int slot);
+        void rearm();
+
+        //a binary heap ordered by deadline
+        std::vector<Entry*> heap;
+        Clock *clock;
+        Waker *waker;
+        //the deadline the waker is currently armed for
+        int64_t armed;
+        //true while runDue() is firing entries
+        bool running;
+        //wakeups in total, in the second starting at rateStart, and in the
+        //second before it
+        uint64_t wakeupCount;
+        int64_t rateStart;
+        int rateCount;
+        int lastRate;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <vector>
+
+#include <QX11Info>
+#include <QCoreApplication>
+#include <QAbstractNativeEventFilter>
+#include <xcb/xcb.h>
+#include <X11/extensions/Xrandr.h>
+
+#include "screen.h"
+#include "fixedpoint.h"
+#include "event.h"
+#include "error.h"
+
+//the whole screen and the monitors on it, from the left. Read on first use
+//and again after the screen changed.
+static ScreenRect wholeScreen;
+static std::vector<ScreenRect> monitors;
+static bool geometryValid = false;
+
+static bool leftOf(const ScreenRect &a, const ScreenRect &b) {
+    return (a.x != b.x) ? a.x < b.x : a.y < b.y;
+}
+
+//tells when XRandR reports a change of the screen
+class ScreenWatcher : public QAbstractNativeEventFilter {
+    public:
+        ScreenWatcher();
+        bool nativeEventFilter(const QByteArray &eventType, void *message, long *result);
+        //where the XRandR events start, or -1 if there's no XRandR 1.3
+        int randrEventBase;
+};
+
+ScreenWatcher::ScreenWatcher() {
+    Display *display = QX11Info::display();
+    int error, major, minor;
+    if (XRRQueryExtension(display, &randrEventBase, &error) &&
+        XRRQueryVersion(display, &major, &minor) && (major > 1 || minor >= 3)) {
+        XRRSelectInput(display, DefaultRootWindow(display), RRScreenChangeNotifyMask);
+    }
+    else {
+        debug_mesg("no XRandR 1.3, absolute axes use the whole screen\n");
+        randrEventBase = -1;
+    }
+    QCoreApplication::instance()->installNativeEventFilter(this);
+}
+
+bool ScreenWatcher::nativeEventFilter(const QByteArray &eventType, void *message, long *) {
+    if (eventType != "xcb_generic_event_t") return false;
+    const xcb_generic_event_t *event = static_cast<const xcb_generic_event_t*>(message);
+    if (randrEventBase >= 0 &&
+        (event->response_type & ~0x80) == randrEventBase + RRScreenChangeNotify) {
+        geometryValid = false;
+    }
+    //Qt needs to see these too
+    return false;
+}
+
+static void readGeometry() {
+    //start listening for changes before reading, so none is missed
+    static ScreenWatcher watcher;
+    Display *display = QX11Info::display();
+    const Window root = DefaultRootWindow(display);
+
+    //the size Xlib remembers isn't updated when the screen changes, so ask
+    Window rootReturn;
+    int x, y;
+    unsigned int width, height, border, depth;
+    XGetGeometry(display, root, &rootReturn, &x, &y, &width, &height, &border, &depth);
+    wholeScreen.x = 0;
+    wholeScreen.y = 0;
+    wholeScreen.width = width;
+    wholeScreen.height = height;
+
+    monitors.clear();
+    if (watcher.randrEventBase >= 0) {
+        XRRScreenResources *resources = XRRGetScreenResourcesCurrent(display, root);
+        for (int i = 0; resources && i < resources->ncrtc; ++i) {
+            XRRCrtcInfo *crtc = XRRGetCrtcInfo(display, resources, resources->crtcs[i]);
+            if (!crtc) continue;
+            //only the CRTCs that actually show something are monitors
+            if (crtc->mode != None && crtc->noutput > 0) {
+                ScreenRect rect = { crtc->x, crtc->y, int(crtc->width), int(crtc->height) };
+                monitors.push_back(rect);
+            }
+            XRRFreeCrtcInfo(crtc);
+        }
+        if (resources) XRRFreeScreenResources(resources);
+    }
+    std::sort(monitors.begin(), monitors.end(), leftOf);
+    debug_mesg("screen is %dx%d with %d monitors\n",
+               wholeScreen.width, wholeScreen.height, int(monitors.size()));
+    geometryValid = true;
+}
+
+void setScreenSize(int width, int height) {
+    wholeScreen.x = 0;
+    wholeScreen.y = 0;
+    wholeScreen.width = width;
+    wholeScreen.height = height;
+    monitors.assign(1, wholeScreen);
+    geometryValid = true;
+}
+
+const ScreenRect &screenRect(int monitor) {
+    if (!geometryValid) readGeometry();
+    if (monitor > 0 && monitor <= int(monitors.size())) return monitors[monitor - 1];
+    return wholeScreen;
+}
+
+AbsolutePointer::AbsolutePointer()
+    : monitor(0), x(0), y(0), sentX(-1), sentY(-1) {
+}
+
+//the pixel at u, from -FIX_ONE to FIX_ONE, of a stretch of the screen
+static inline int pixel(int32_t u, int start, int length) {
+    return start + int((int64_t(u + FIX_ONE) * (length - 1) + FIX_ONE) / (2 * FIX_ONE));
+}
+
+void AbsolutePointer::move(bool vertical, int32_t u) {
+    if (vertical) y = u;
+    else x = u;
+    const ScreenRect &rect = screenRect(monitor);
+    const int px = pixel(x, rect.x, rect.width);
+    const int py = pixel(y, rect.y, rect.height);
+    if (px == sentX && py == sentY) return;
+    sentX = px;
+    sentY = py;
+
+    FakeEvent e;
+    e.type = FakeEvent::MouseMoveAbsolute;
+    e.move.x = px;
+    e.move.y = py;
+    sendevent(e);
+}
+
+void AbsolutePointer::reset() {
+    sentX = -1;
+    sentY = -1;
+}
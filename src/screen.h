@@ -0,0 +1,45 @@
+#ifndef QJOYPAD_SCREEN_H
+#define QJOYPAD_SCREEN_H
+
+#include <stdint.h>
+
+#include "constant.h"
+
+//a rectangle on the screen, in pixels
+struct ScreenRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+//the whole screen for 0, and monitor n for n > 0, counted from the left.
+//Monitors that aren't there give the whole screen as well. The geometry is
+//asked from XRandR once and again only after it reports that the screen
+//changed, so this is cheap enough to call for every event.
+const ScreenRect &screenRect(int monitor);
+//use a screen of this size, with a single monitor, instead of asking XRandR.
+//For the replay tool, which has no X server.
+void setScreenSize(int width, int height);
+
+//where the absolute axes of one device put the mouse pointer on one monitor.
+//The horizontal axis sets x and the vertical one y, so a pair of axes moves
+//the pointer together. Nothing is sent while the pointer would stay on the
+//same pixel.
+struct AbsolutePointer {
+    AbsolutePointer();
+    //put the pointer at u along one direction, from -FIX_ONE (left or top)
+    //to FIX_ONE (right or bottom) of the monitor
+    void move(bool vertical, int32_t u);
+    //forget what was sent, so the next move() sends again
+    void reset();
+
+    int monitor;
+    int32_t x;
+    int32_t y;
+    //the position that was last sent, -1 for none
+    int sentX;
+    int sentY;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "sensor.h"
+#include "error.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define NLONGS(x) (((x) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+
+static bool testBit(const unsigned long *bits, int bit) {
+    return (bits[bit / BITS_PER_LONG] >> (bit % BITS_PER_LONG)) & 1;
+}
+
+MotionSensor::MotionSensor(GyroData *gyro, QObject *parent)
+    : QObject(parent), gyro(gyro), fd(-1), notifier(0),
+      frameTime(0), hasFrameTime(false), lastTime(0), hasLast(false), dropping(false) {
+    for (int i = 0; i < 3; ++ i) {
+        scale[i] = 1.0F;
+        rate[i] = 0;
+    }
+}
+
+MotionSensor::~MotionSensor() {
+    close();
+}
+
+//the device an input device like js0 or event5 is part of, the same for all
+//input devices of one pad (its HID device), or a null string without sysfs
+static QString parentDevice(const QString &node) {
+    const QString input = QFileInfo("/sys/class/input/" + node + "/device").canonicalFilePath();
+    if (input.isEmpty()) return QString();
+    return QFileInfo(input).absolutePath();
+}
+
+QString MotionSensor::find(const QString &devdir, int index, const QString &name) {
+    const QString parent = parentDevice(QString("js%1").arg(index));
+    if (parent.isEmpty() && name.isEmpty()) return QString();
+    //the joystick devices might live somewhere else, the event devices don't
+    QDir dir(devdir);
+    if (!dir.exists("event0")) dir.setPath("/dev/input");
+    foreach (const QString &entry, dir.entryList(QStringList("event*"), QDir::System)) {
+        const QString path = dir.filePath(entry);
+        int dev = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK);
+        if (dev < 0) continue;
+
+        unsigned long props[NLONGS(INPUT_PROP_CNT)];
+        unsigned long absBits[NLONGS(ABS_CNT)];
+        char id[256];
+        memset(props, 0, sizeof(props));
+        memset(absBits, 0, sizeof(absBits));
+        memset(id, 0, sizeof(id));
+        bool found =
+            ioctl(dev, EVIOCGPROP(sizeof(props)), props) >= 0 &&
+            testBit(props, INPUT_PROP_ACCELEROMETER) &&
+            ioctl(dev, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits) >= 0 &&
+            testBit(absBits, ABS_RX);
+        if (found && !parent.isEmpty()) {
+            found = parentDevice(entry) == parent;
+        }
+        else if (found) {
+            found = ioctl(dev, EVIOCGNAME(sizeof(id) - 1), id) >= 0 &&
+                //"Sony Interactive Entertainment Wireless Controller Motion Sensors"
+                QString::fromUtf8(id).startsWith(name);
+        }
+        ::close(dev);
+        if (found) {
+            debug_mesg("motion sensors of js%d: %s\n", index, qPrintable(path));
+            return path;
+        }
+    }
+    return QString();
+}
+
+bool MotionSensor::open(const QString &path) {
+    close();
+    if (path.isEmpty()) return false;
+    fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        debug_mesg("open(%s): %s\n", qPrintable(path), strerror(errno));
+        return false;
+    }
+    //the resolution is in units per degree per second
+    for (int i = 0; i < 3; ++ i) {
+        input_absinfo info;
+        memset(&info, 0, sizeof(info));
+        ioctl(fd, EVIOCGABS(ABS_RX + i), &info);
+        scale[i] = (info.resolution > 0) ? 1.0F / info.resolution : 1.0F;
+        rate[i] = info.value;
+    }
+    hasFrameTime = false;
+    hasLast = false;
+    dropping = false;
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+    return true;
+}
+
+void MotionSensor::close() {
+    if (notifier) {
+        disconnect(notifier, 0, 0, 0);
+        notifier->setEnabled(false);
+        delete notifier;
+        notifier = 0;
+    }
+    if (fd >= 0) {
+        if (::close(fd) != 0) {
+            debug_mesg("close(sensor %d): %s\n", fd, strerror(errno));
+        }
+        fd = -1;
+    }
+    gyro->release();
+}
+
+void MotionSensor::readRates() {
+    for (int i = 0; i < 3; ++ i) {
+        input_absinfo info;
+        if (ioctl(fd, EVIOCGABS(ABS_RX + i), &info) >= 0) {
+            rate[i] = info.value;
+        }
+    }
+}
+
+void MotionSensor::readEvents() {
+    ssize_t len = 0;
+    while (fd >= 0 && (len = read(fd, buffer, sizeof(buffer))) > 0) {
+        const int count = len / sizeof(input_event);
+        for (int i = 0; i < count; ++ i) {
+            const input_event &ev = buffer[i];
+            if (ev.type == EV_ABS) {
+                if (ev.code >= ABS_RX && ev.code <= ABS_RZ) {
+                    rate[ev.code - ABS_RX] = ev.value;
+                }
+            }
+            else if (ev.type == EV_MSC && ev.code == MSC_TIMESTAMP) {
+                frameTime = uint32_t(ev.value);
+                hasFrameTime = true;
+            }
+            else if (ev.type == EV_SYN && ev.code == SYN_DROPPED) {
+                dropping = true;
+            }
+            else if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                if (dropping) {
+                    //nobody knows how long the pad turned at which rate
+                    dropping = false;
+                    readRates();
+                    hasLast = false;
+                    continue;
+                }
+                if (!hasFrameTime) {
+                    frameTime = uint32_t(ev.time.tv_sec * 1000000 + ev.time.tv_usec);
+                }
+                if (hasLast) {
+                    uint32_t dt = frameTime - lastTime;
+                    if (dt > SENSOR_MAX_DT_USEC) dt = 0;
+                    if (dt > 0) {
+                        const float rates[3] = {
+                            rate[0] * scale[0], rate[1] * scale[1], rate[2] * scale[2]
+                        };
+                        gyro->frame(rates, dt * 1e-6F);
+                    }
+                }
+                lastTime = frameTime;
+                hasLast = true;
+                hasFrameTime = false;
+            }
+        }
+        if (len < (ssize_t)sizeof(buffer)) break;
+    }
+    if (len < 0 && errno != EAGAIN) {
+        debug_mesg("read(sensor %d): %s\n", fd, strerror(errno));
+        close();
+        return;
+    }
+    //don't move the mouse under the settings dialog, same as the joystick
+    if (qApp->activeWindow() != 0 && qApp->activeModalWidget() != 0) {
+        gyro->release();
+        return;
+    }
+    gyro->flush();
+}
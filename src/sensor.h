@@ -0,0 +1,58 @@
+#ifndef QJOYPAD_SENSOR_H
+#define QJOYPAD_SENSOR_H
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#include <QObject>
+#include <QString>
+#include <QSocketNotifier>
+
+#include "constant.h"
+#include "gyrodata.h"
+
+//The motion sensors of a pad. Drivers like hid-playstation and hid-nintendo
+//put them on an evdev device of their own, next to the joystick, and report
+//hundreds of frames a second. Everything waiting is read with one read() and
+//integrated into the GyroData, which is then flushed once. The frames are
+//timed by MSC_TIMESTAMP where the driver sends it, by the event time where
+//it doesn't.
+class MotionSensor : public QObject {
+    Q_OBJECT
+    public:
+        MotionSensor(GyroData *gyro, QObject *parent);
+        ~MotionSensor();
+        //the event device in devdir with the motion sensors of joystick
+        //index, or a null string if there is none. The sensors belong to the
+        //same device as the joystick in sysfs, so two identical pads each get
+        //their own. Without sysfs, the first sensors whose name starts with
+        //name (the name of the joystick) are taken.
+        static QString find(const QString &devdir, int index, const QString &name);
+        bool open(const QString &path);
+        void close();
+        bool isOpen() const { return fd >= 0; }
+    private slots:
+        void readEvents();
+    private:
+        //read the current rates, after the device dropped events
+        void readRates();
+
+        GyroData *gyro;
+        int fd;
+        QSocketNotifier *notifier;
+        //degrees per second per unit of ABS_RX, ABS_RY and ABS_RZ
+        float scale[3];
+        //the last reported rates, in device units
+        int rate[3];
+        //the time of the frame being read, and of the one before, in
+        //microseconds. hasLast is false until there is one before.
+        uint32_t frameTime;
+        bool hasFrameTime;
+        uint32_t lastTime;
+        bool hasLast;
+        //the device dropped events, skip to the next SYN_REPORT
+        bool dropping;
+        input_event buffer[SENSOR_READ_EVENTS];
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include <time.h>
+
+#include <QTextStream>
+
+#include "stats.h"
+#include "scheduler.h"
+
+static const char *const outputNames[] = {
+    "key up", "key down", "mouse up", "mouse down", "mouse move", "mouse move absolute"
+};
+
+LatencyHistogram::LatencyHistogram() {
+    for (int i = 0; i < STATS_LATENCY_BUCKETS; ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::add(uint32_t usec) {
+    //the number of bits needed for usec
+    int bucket = (usec == 0) ? 0 : 32 - __builtin_clz(usec);
+    if (bucket >= STATS_LATENCY_BUCKETS) bucket = STATS_LATENCY_BUCKETS - 1;
+    statAdd(buckets[bucket]);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (int i = 0; i < STATS_LATENCY_BUCKETS; ++i) {
+        total += buckets[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint32_t LatencyHistogram::percentile(int percent) const {
+    const uint64_t total = count();
+    if (total == 0) return 0;
+    //the rank of the sample we're looking for, rounded up
+    const uint64_t rank = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_LATENCY_BUCKETS; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return uint32_t(1) << i;
+    }
+    return uint32_t(1) << (STATS_LATENCY_BUCKETS - 1);
+}
+
+DeviceStats *DeviceStats::current = 0;
+
+DeviceStats::DeviceStats(DeviceStats *parent)
+    : batches(0), eventsRead(0), eventsCoalesced(0), maxQueueDepth(0), resyncs(0),
+      parent(parent) {
+    for (int i = 0; i <= FakeEvent::MouseMoveAbsolute; ++i) {
+        outputEvents[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void DeviceStats::addBatch(uint32_t events, uint32_t coalesced, uint32_t usec) {
+    statAdd(batches);
+    statAdd(eventsRead, events);
+    statAdd(eventsCoalesced, coalesced);
+    statMax(maxQueueDepth, events);
+    latency.add(usec);
+    if (parent) parent->addBatch(events, coalesced, usec);
+}
+
+void DeviceStats::addResync() {
+    statAdd(resyncs);
+    if (parent) parent->addResync();
+}
+
+void DeviceStats::addOutput(FakeEvent::EventType type) {
+    statAdd(outputEvents[type]);
+    if (parent) parent->addOutput(type);
+}
+
+void DeviceStats::write(QTextStream &stream) const {
+    stream << "  batches " << quint64(batches.load(std::memory_order_relaxed)) << "\n"
+           << "  events read " << quint64(eventsRead.load(std::memory_order_relaxed)) << "\n"
+           << "  events coalesced " << quint64(eventsCoalesced.load(std::memory_order_relaxed)) << "\n"
+           << "  max queue depth " << maxQueueDepth.load(std::memory_order_relaxed) << "\n"
+           << "  resyncs " << quint64(resyncs.load(std::memory_order_relaxed)) << "\n"
+           << "  latency usec p50 <" << latency.percentile(50)
+           << ", p90 <" << latency.percentile(90)
+           << ", p99 <" << latency.percentile(99)
+           << ", max <" << latency.percentile(100) << "\n";
+    for (int i = 0; i <= FakeEvent::MouseMoveAbsolute; ++i) {
+        stream << "  sent " << outputNames[i] << " "
+               << quint64(outputEvents[i].load(std::memory_order_relaxed)) << "\n";
+    }
+}
+
+Stats::Stats()
+    : flushes(0), outputDropped(0), outputQueueMax(0), outputOverflowMax(0),
+      motionTicks(0), layoutSwitches(0) {
+    for (int i = 0; i <= FakeEvent::MouseMoveAbsolute; ++i) {
+        outputEvents[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+Stats &Stats::instance() {
+    static Stats stats;
+    return stats;
+}
+
+uint64_t Stats::usecNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void Stats::write(QTextStream &stream) const {
+    const Scheduler &scheduler = Scheduler::instance();
+
+    stream << "All devices:\n";
+    input.write(stream);
+    stream << "Output:\n";
+    for (int i = 0; i <= FakeEvent::MouseMoveAbsolute; ++i) {
+        stream << "  " << outputNames[i] << " "
+               << quint64(outputEvents[i].load(std::memory_order_relaxed)) << "\n";
+    }
+    stream << "  flushes " << quint64(flushes.load(std::memory_order_relaxed)) << "\n"
+           << "  dropped " << quint64(outputDropped.load(std::memory_order_relaxed)) << "\n"
+           << "  max queue depth " << outputQueueMax.load(std::memory_order_relaxed) << "\n"
+           << "  max overflow " << outputOverflowMax.load(std::memory_order_relaxed) << "\n"
+           << "Engine:\n"
+           << "  wakeups " << quint64(scheduler.wakeups())
+           << " (" << scheduler.wakeupsPerSecond() << "/s)\n"
+           << "  motion ticks " << quint64(motionTicks.load(std::memory_order_relaxed)) << "\n"
+           << "  layout switches " << quint64(layoutSwitches.load(std::memory_order_relaxed)) << "\n";
+}
@@ -0,0 +1,117 @@
+#ifndef QJOYPAD_STATS_H
+#define QJOYPAD_STATS_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include "event.h"
+
+class QTextStream;
+
+//the number of buckets in a LatencyHistogram. The last one holds everything
+//from 2^(STATS_LATENCY_BUCKETS - 2) microseconds on.
+#define STATS_LATENCY_BUCKETS 24
+
+//Counters are only ever added to with relaxed atomics. Nothing is ordered by
+//them, they only have to be cheap in the hot path and must not tear when a
+//snapshot is taken while events are being handled.
+inline void statAdd(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void statMax(std::atomic<uint32_t> &gauge, uint32_t value) {
+    uint32_t old = gauge.load(std::memory_order_relaxed);
+    while (value > old &&
+           !gauge.compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+    }
+}
+
+//latencies in microseconds. Bucket i counts the ones below 2^i, so the
+//percentiles are only good to a factor of 2, which is all we need to see
+//where the time goes.
+class LatencyHistogram {
+    public:
+        LatencyHistogram();
+        void add(uint32_t usec);
+        uint64_t count() const;
+        //the latency that percent of all samples were below, or 0 if there
+        //are no samples yet
+        uint32_t percentile(int percent) const;
+    private:
+        std::atomic<uint64_t> buckets[STATS_LATENCY_BUCKETS];
+};
+
+//what happens on the input side of one device, and the fake events it
+//causes. Everything is added to the totals in parent as well.
+class DeviceStats {
+    public:
+        explicit DeviceStats(DeviceStats *parent = 0);
+        //one call of handleJoyEvents(): how many events were read, how many
+        //of them were merged into a later one, and how long it took from
+        //reading the first event to having sent everything that followed.
+        void addBatch(uint32_t events, uint32_t coalesced, uint32_t usec);
+        //events were lost and the state of every control read again
+        void addResync();
+        //a fake event was sent for this device
+        void addOutput(FakeEvent::EventType type);
+        void write(QTextStream &stream) const;
+
+        //the device the fake events sent right now are counted for, or 0.
+        //Only used on the GUI thread, set with an OutputScope.
+        static DeviceStats *current;
+
+        std::atomic<uint64_t> batches;
+        std::atomic<uint64_t> eventsRead;
+        std::atomic<uint64_t> eventsCoalesced;
+        //the most events that were waiting at once
+        std::atomic<uint32_t> maxQueueDepth;
+        std::atomic<uint64_t> resyncs;
+        LatencyHistogram latency;
+        //fake events sent for the device, indexed by FakeEvent::EventType.
+        //The mouse movement of gradient axes, sticks and the gyro goes out
+        //merged for all devices from the MotionBatch, so it is only in the
+        //totals of Stats.
+        std::atomic<uint64_t> outputEvents[FakeEvent::MouseMoveAbsolute + 1];
+    private:
+        DeviceStats *parent;
+};
+
+//counts the fake events sent while it exists for stats, which can be 0
+class OutputScope {
+    public:
+        explicit OutputScope(DeviceStats *stats) : previous(DeviceStats::current) {
+            DeviceStats::current = stats;
+        }
+        ~OutputScope() { DeviceStats::current = previous; }
+    private:
+        DeviceStats *previous;
+};
+
+//the statistics of the whole engine
+class Stats {
+    public:
+        Stats();
+        static Stats &instance();
+        //microseconds on CLOCK_MONOTONIC, for measuring latencies
+        static uint64_t usecNow();
+        //the totals and the output side. The scheduler wakeups are added
+        //when writing, the Scheduler counts those itself.
+        void write(QTextStream &stream) const;
+
+        //the input of all devices together
+        DeviceStats input;
+        //fake events actually sent, indexed by FakeEvent::EventType
+        std::atomic<uint64_t> outputEvents[FakeEvent::MouseMoveAbsolute + 1];
+        std::atomic<uint64_t> flushes;
+        //events dropped because the output queue and its overflow were full,
+        //the most events that were ever waiting in the queue, and in the
+        //overflow (see OutputThread)
+        std::atomic<uint64_t> outputDropped;
+        std::atomic<uint32_t> outputQueueMax;
+        std::atomic<uint32_t> outputOverflowMax;
+        //ticks of the mouse motion batch
+        std::atomic<uint64_t> motionTicks;
+        std::atomic<uint64_t> layoutSwitches;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "stickdata.h"
+#include "motion.h"
+
+StickData::StickData() {
+    defined = false;
+    xAxis = 0;
+    yAxis = 1;
+    dZone = DZONE;
+    xZone = XZONE;
+    maxSpeed = 100;
+    transferCurve = Quadratic;
+    sensitivity = 1.0F;
+    reverseX = false;
+    reverseY = false;
+    x = 0;
+    y = 0;
+    changed = false;
+    laneX = -1;
+    laneY = -1;
+    restX = 0;
+    restY = 0;
+    configure();
+}
+
+void StickData::configure() {
+    inverseRange = fixScale(dZone, xZone);
+    exponent = fixExponent(sensitivity);
+    if (isOn()) {
+        //the settings of the lanes are out of date
+        changed = true;
+    }
+}
+
+void StickData::jsevent(int axis, int value) {
+    if (axis == xAxis) x = value;
+    if (axis == yAxis) y = value;
+    changed = true;
+}
+
+void StickData::update() {
+    if (!changed) return;
+    changed = false;
+
+    MotionBatch &batch = MotionBatch::instance();
+    const int magnitude = int(isqrt(uint32_t(x * x) + uint32_t(y * y)));
+
+    //a round dead zone, so diagonals start moving as early as the rest
+    if (magnitude <= dZone) {
+        release();
+        return;
+    }
+    if (laneX < 0) {
+        laneX = batch.acquire(reverseX ? -1 : 1, 0, restX);
+        laneY = batch.acquire(0, reverseY ? -1 : 1, restY);
+    }
+
+    //both lanes get the curve of the magnitude, and their share of the speed
+    //keeps the direction of the stick.
+    const int64_t speed = int64_t(maxSpeed) << SPEED_SHIFT;
+    batch.set(laneX, magnitude, dZone, xZone, inverseRange, transferCurve, exponent,
+              int(speed * x / magnitude));
+    batch.set(laneY, magnitude, dZone, xZone, inverseRange, transferCurve, exponent,
+              int(speed * y / magnitude));
+}
+
+void StickData::release() {
+    if (laneX >= 0) {
+        restX = MotionBatch::instance().releaseLane(laneX);
+        restY = MotionBatch::instance().releaseLane(laneY);
+        laneX = -1;
+        laneY = -1;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef QJOYPAD_STICKDATA_H
+#define QJOYPAD_STICKDATA_H
+
+#include "axisdata.h"
+
+//two axes of one stick that move the mouse together. Instead of a square
+//dead zone and a curve per axis, the dead zone and the transfer curve are
+//applied to how far the stick is pushed in any direction, and the direction
+//is kept as it is. The movement goes through two lanes of the MotionBatch
+//(motion.h), so it is sent together with everything else.
+struct StickData : public AxisEnums {
+    StickData();
+
+    //remember a new value of one of the axes. Nothing happens until update().
+    void jsevent(int axis, int value);
+    //work out the movement from the current values of both axes. A JoyPad
+    //calls this once for all the events it read in one go.
+    void update();
+    //stop moving the mouse and return to a neutral state
+    void release();
+    //recalculate everything derived from the settings
+    void configure();
+    //true iff the stick is moving the mouse
+    bool isOn() const { return laneX >= 0; }
+
+    //settings. defined is false for the placeholders in front of a stick
+    //with a higher number, which take no axes. xAxis and yAxis are indices
+    //into the JoyPad's axis table.
+    bool defined;
+    int xAxis;
+    int yAxis;
+    int dZone;
+    int xZone;
+    int maxSpeed;
+    TransferCurve transferCurve;
+    float sensitivity;
+    bool reverseX;
+    bool reverseY;
+    //fixScale() of the zones and fixExponent() of the sensitivity
+    int32_t inverseRange;
+    int64_t exponent;
+
+    //current state
+    int x;
+    int y;
+    //true iff x or y changed since the last update()
+    bool changed;
+    int laneX;
+    int laneY;
+    //the sub-pixel movement left over, in 1/2^REST_SHIFT pixel
+    int32_t restX;
+    int32_t restY;
+};
+
+#endif